@@ -1,22 +1,164 @@
 #include <algorithm>
 #include "Chip8.h"
+#include "Chip8Debugger.h"
 #include <bitset>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <chrono>
 #include <thread>
+#include <type_traits>
+
+
+// State hashing. Each memory byte and display word contributes a key
+// XORed into a running hash, so a write costs two key lookups. Zero
+// contributes nothing, so cleared memory and display hash to 0.
+static uint64_t hash_mix(uint64_t x){
+	// splitmix64 finalizer
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+static uint64_t memory_key(uint16_t address, uint8_t value){
+	return value ? hash_mix(((uint64_t)address << 8) | value) : 0;
+}
+
+static uint64_t display_key(int plane, int y, int word, uint64_t value){
+	uint64_t index = 0x10000 | (plane << 7) | (y << 1) | word;
+	return value ? hash_mix(value ^ hash_mix(index)) : 0;
+}
+
+
+Chip8::Chip8(Chip8Machine machine){
+	this->machine = machine;
+	memory_mask = machine == MACHINE_XOCHIP ? 0xFFFF : 0x0FFF;
+	extended_memory = machine == MACHINE_XOCHIP ? new uint8_t[0x10000] : NULL;
+	memory = extended_memory ? extended_memory : inline_memory;
+	long_op = machine == MACHINE_XOCHIP ? 0xF000 : 0x10000;
+
+	debug = 0;								// Debug mode flags
+	idle_skip = true;						// Idle loop fast-forward
+	sprite_cache_enabled = true;			// DRW row mask cache
+	sprite_cache_hit_count = 0;
+	executed_op_count = 0;					// Metrics
+	skipped_op_count = 0;
+	key_read_count = 0;
+	display_change_count = 0;
+	display_change_op = NO_PROBE_OP;
+	probe_key_read_op = NO_PROBE_OP;
+	probe_display_change_op = NO_PROBE_OP;
+	key_version = 0;
+	watch_read_pages = 0;					// Debugger
+	watch_write_pages = 0;
+	debugger = NULL;
+	update_hooked();
+
+	// Split memory into WATCH_PAGE_COUNT pages
+	watch_page_shift = 0;
+	while ((get_memory_size() >> watch_page_shift) > WATCH_PAGE_COUNT){
+		watch_page_shift++;
+	}
+
+	init_registers();
+}
+
+Chip8::Chip8(const Chip8 &other){
+	extended_memory = NULL;
+	debugger = NULL;
+	watch_read_pages = 0;
+	watch_write_pages = 0;
+	copy_from(other);
+}
+
+Chip8& Chip8::operator=(const Chip8 &other){
+	if (this != &other){
+		copy_from(other);
+	}
+	return *this;
+}
+
+Chip8::~Chip8(){
+	delete[] extended_memory;
+}
+
+void Chip8::copy_from(const Chip8 &other){
+	// Every member is plain data, so copy them in one go; XO-CHIP stops
+	// before the unused inline memory. The copy keeps its own heap memory
+	// and its own debugger, if any, rather than sharing the other's.
+	static_assert(std::is_standard_layout<Chip8>::value, "Chip8 is copied with memcpy");
+	uint8_t *extended = extended_memory;
+	Chip8Debugger *own_debugger = debugger;
+	uint64_t own_read_pages = watch_read_pages;
+	uint64_t own_write_pages = watch_write_pages;
+
+	bool extended_machine = other.extended_memory != NULL;
+	std::memcpy((void*) this, (const void*) &other, extended_machine ? offsetof(Chip8, inline_memory) : sizeof(Chip8));
+
+	if (extended_machine){
+		if (!extended){
+			extended = new uint8_t[0x10000];
+		}
+		std::memcpy(extended, other.extended_memory, 0x10000);
+	} else {
+		delete[] extended;
+		extended = NULL;
+	}
+	extended_memory = extended;
+	memory = extended ? extended : inline_memory;
 
+	debugger = own_debugger;
+	watch_read_pages = own_debugger ? own_read_pages : 0;
+	watch_write_pages = own_debugger ? own_write_pages : 0;
+	update_hooked();
+}
 
+void Chip8::update_hooked(){
+	hooked = debug || watch_read_pages || watch_write_pages;
+}
+
+Chip8Machine Chip8::get_machine(){
+	return machine;
+}
+uint32_t Chip8::get_memory_size() const{
+	return memory_mask + 1;
+}
 
-Chip8::Chip8(){
+void Chip8::reset(){
 	init_registers();
 }
 
-Chip8::~Chip8(){}
+int Chip8::load_rom(const uint8_t *rom, uint16_t length){
+	// Swap in a new program, keeping the interpreter area (fonts) below
+	// 0x200 and the machine's configuration. Returns 0 if it doesn't fit.
+	if (length > get_memory_size() - 0x200){
+		return 0;
+	}
+
+	uint8_t interpreter[0x200];
+	std::copy(memory, memory+0x200, interpreter);
+	init_registers();
+	for (int i = 0; i < 0x200; ++i){
+		store_memory(i, interpreter[i]);
+	}
+	for (int i = 0; i < length; ++i){
+		store_memory(0x200+i, rom[i]);
+	}
+
+	return 1;
+}
 
 void Chip8::init_registers(){
-	std::fill(memory, memory+4096, 0);		// RAM
+	std::fill(memory, memory+get_memory_size(), 0);	// RAM
+	memory_hash = 0;
+	std::fill(page_versions, page_versions+WATCH_PAGE_COUNT, 0);
+	for (int i = 0; i < SPRITE_CACHE_SIZE; ++i){
+		sprite_cache[i].n = 0;
+	}
 	std::fill(V, V+16, 0);					// Multi-purpose registers. V[15] is reserved
 	I = 0;									// Address register
 	delay_timer = 0;						// Delay timer
@@ -24,20 +166,87 @@ void Chip8::init_registers(){
 	PC = 0x200;								// Program counter
 	SP = 0;									// Stack pointer
 	std::fill(stack, stack+16, 0);			// Call stack
-	fill_display(0);						// Game display
-	debug = 0xFF;							// Debug mode flags
+	hires = false;							// Game display
+	plane_mask = 1;
+	std::fill(&planes[0][0][0], &planes[0][0][0] + 2*64*2, 0);
+	display_hash = 0;
+	std::fill(audio_pattern, audio_pattern+16, 0);	// XO-CHIP audio
+	pitch = 64;
+	std::fill(keys, keys+16, 0);			// Hex keypad
+	key_version++;
 }
 
 
 uint8_t Chip8::get_at_memory_address(uint16_t address){
-	return memory[address];
+	return memory[address & memory_mask];
 }
 void Chip8::set_memory_address(uint16_t address, uint8_t value){
-	// TODO
+	store_memory(address & memory_mask, value);
 }
 void Chip8::set_memory_block(uint16_t address, uint8_t *value, uint16_t length){
 	for (int i = 0; i < length; ++i){
-		memory[address+i] = value[i];
+		store_memory((address+i) & memory_mask, value[i]);
+	}
+}
+
+// All memory and display writes go through these to keep the hashes current
+void Chip8::store_memory(uint16_t address, uint8_t value){
+	uint8_t &cell = memory[address];
+	memory_hash ^= memory_key(address, cell) ^ memory_key(address, value);
+	cell = value;
+	page_versions[address >> watch_page_shift]++;
+}
+void Chip8::store_display_word(int plane, int y, int word, uint64_t value){
+	uint64_t &cell = planes[plane][y][word];
+	if (cell == value){
+		return;
+	}
+	display_hash ^= display_key(plane, y, word, cell) ^ display_key(plane, y, word, value);
+	cell = value;
+
+	// Count each op that changes the display once, by its op count
+	if (display_change_op != executed_op_count){
+		display_change_op = executed_op_count;
+		display_change_count++;
+		if (probe_key_read_op != NO_PROBE_OP && probe_display_change_op == NO_PROBE_OP){
+			probe_display_change_op = executed_op_count;
+		}
+	}
+}
+
+// Memory accesses made by ops go through these. Ops only check for
+// watched pages when hooked, so the plain path pays nothing for them.
+template<bool HOOKED>
+uint8_t Chip8::read_memory(uint16_t address){
+	address &= memory_mask;
+	if (HOOKED && watch_read_pages & (1ull << (address >> watch_page_shift))){
+		debugger->on_memory_access(address, false);
+	}
+	return memory[address];
+}
+template<bool HOOKED>
+void Chip8::write_memory(uint16_t address, uint8_t value){
+	address &= memory_mask;
+	if (HOOKED && watch_write_pages & (1ull << (address >> watch_page_shift))){
+		debugger->on_memory_access(address, true);
+	}
+	store_memory(address, value);
+}
+
+uint16_t Chip8::fetch_op(uint16_t address){
+	// Ops are big endian
+	return (memory[address & memory_mask] << 8) | memory[(address+1) & memory_mask];
+}
+
+void Chip8::skip_next_op(){
+	// XO-CHIP's F000 nnnn is 4 bytes long, so skips must step over all of it
+	PC += fetch_op(PC) == long_op ? 4 : 2;
+}
+
+void Chip8::note_key_read(){
+	key_read_count++;
+	if (probe_key_read_op == NO_PROBE_OP){
+		probe_key_read_op = executed_op_count;
 	}
 }
 
@@ -96,52 +305,312 @@ void Chip8::set_stack(uint8_t index, uint16_t address){
 	stack[index] = address;
 }
 void Chip8::push_stack(uint16_t address){
-	stack[SP] = address;
+	stack[SP & 0xF] = address;
 	inc_SP();
 }
 uint16_t Chip8::pop_stack(){
-	return stack[SP];
-	set_stack(SP, 0);
 	dec_SP();
+	uint16_t address = stack[SP & 0xF];
+	set_stack(SP & 0xF, 0);
+	return address;
 }
 
-uint8_t* Chip8::get_display(){
-	return display;
+uint8_t Chip8::get_display_pixel(int x, int y){
+	// Returns the pixel's plane bits, plane 0 in bit 0
+	uint64_t bit = 1ull << (63 - (x & 63));
+	int word = x >> 6;
+
+	return ((planes[0][y][word] & bit) ? 1 : 0)
+		| ((planes[1][y][word] & bit) ? 2 : 0);
+}
+const uint64_t* Chip8::get_display_row(int plane, int y){
+	// Two words, only the first used at 64 pixels wide
+	return planes[plane][y];
 }
 void Chip8::set_display_pixel(uint16_t index, uint8_t value){
-	display[index] = value;
+	int x = index % get_display_width();
+	int y = index / get_display_width();
+	uint64_t bit = 1ull << (63 - (x & 63));
+
+	for (int plane = 0; plane < 2; ++plane){
+		uint64_t word = planes[plane][y][x >> 6];
+		store_display_word(plane, y, x >> 6, (value & (1 << plane)) ? word | bit : word & ~bit);
+	}
 }
 void Chip8::set_display_block(uint16_t index, uint8_t value, uint16_t length){
-	// TODO
+	for (int i = 0; i < length; ++i){
+		set_display_pixel(index+i, value);
+	}
 }
 void Chip8::fill_display(uint8_t value){
-	int display_size = get_display_width() * get_display_height();
-	std::fill(display, display+display_size, value);
+	// Fills every visible pixel of both planes with the value's plane bits.
+	// Pixels outside the current resolution are kept clear.
+	for (int plane = 0; plane < 2; ++plane){
+		uint64_t fill = (value & (1 << plane)) ? ~0ull : 0;
+		for (int y = 0; y < 64; ++y){
+			bool visible = y < get_display_height();
+			store_display_word(plane, y, 0, visible ? fill : 0);
+			store_display_word(plane, y, 1, visible && hires ? fill : 0);
+		}
+	}
 }
 int Chip8::get_display_width(){
-	return 64;
+	return hires ? 128 : 64;
 }
 int Chip8::get_display_height(){
-	return 32;
+	return hires ? 64 : 32;
+}
+bool Chip8::get_hires(){
+	return hires;
+}
+uint8_t Chip8::get_plane_mask(){
+	return plane_mask;
+}
+
+const uint8_t* Chip8::get_audio_pattern(){
+	return audio_pattern;
+}
+uint8_t Chip8::get_pitch(){
+	return pitch;
+}
+
+uint8_t Chip8::get_key(uint8_t index){
+	return keys[index & 0xF];
+}
+void Chip8::set_key(uint8_t index, uint8_t pressed){
+	keys[index & 0xF] = pressed;
+	key_version++;
+}
+void Chip8::release_all_keys(){
+	std::fill(keys, keys+16, 0);
+	key_version++;
+}
+uint32_t Chip8::get_key_version(){
+	return key_version;
+}
+
+uint8_t Chip8::get_debug(){
+	return debug;
+}
+void Chip8::set_debug(uint8_t flags){
+	debug = flags;
+	update_hooked();
+}
+
+Chip8Debugger* Chip8::get_debugger(){
+	return debugger;
+}
+void Chip8::set_debugger(Chip8Debugger *debugger){
+	this->debugger = debugger;
+	if (!debugger){
+		set_watch_pages(0, 0);
+	}
+}
+void Chip8::set_watch_pages(uint64_t read_pages, uint64_t write_pages){
+	// Pages can only be watched while a debugger is attached
+	watch_read_pages = debugger ? read_pages : 0;
+	watch_write_pages = debugger ? write_pages : 0;
+	update_hooked();
+}
+int Chip8::get_watch_page_shift(){
+	return watch_page_shift;
 }
 
 
 void Chip8::draw_sprite(uint16_t address, uint8_t length, uint8_t x, uint8_t y){
-	
-	for (int j = 0; j < length; ++j){
+	// Sets the sprite's pixels on plane 0, without XOR or collision
+	for (int j = 0; j < length && y+j < get_display_height(); ++j){
+		uint64_t row = (uint64_t)get_at_memory_address(address+j) << 56;
+		int px = x % get_display_width();
+
+		uint64_t *dst = planes[0][y+j];
+		if (px < 64){
+			store_display_word(0, y+j, 0, dst[0] | row >> px);
+			if (hires && px > 56){
+				store_display_word(0, y+j, 1, dst[1] | row << (64 - px));
+			}
+		} else {
+			store_display_word(0, y+j, 1, dst[1] | row >> (px - 64));
+		}
+	}
+}
+
+const uint64_t* Chip8::get_sprite_masks(uint16_t address, uint8_t n, uint8_t shift){
+	// Games redraw the same few sprites at the same few columns, so keep
+	// their rows ready to XOR in. A write to either page the sprite sits
+	// in bumps its version and so invalidates the entry.
+	address &= memory_mask;
+	uint16_t last = (address + n - 1) & memory_mask;
+	uint32_t first_version = page_versions[address >> watch_page_shift];
+	uint32_t last_version = page_versions[last >> watch_page_shift];
+
+	// Fibonacci hash the sprite and all 6 bits of the shift separately, so
+	// one sprite at 8 columns, or at x and x+32, gets distinct slots
+	uint32_t sprite_hash = (address | (uint32_t) n << 16) * 0x9E3779B1u;
+	uint32_t shift_hash = shift * 0x9E3779B1u;
+	SpriteCacheEntry &entry = sprite_cache[(sprite_hash ^ shift_hash) >> (32 - SPRITE_CACHE_BITS)];
+	if (entry.n == n && entry.address == address && entry.shift == shift
+		&& entry.first_version == first_version && entry.last_version == last_version){
+		sprite_cache_hit_count++;
+		return entry.rows;
+	}
+
+	for (int j = 0; j < n; ++j){
+		entry.rows[j] = ((uint64_t)memory[(address+j) & memory_mask] << 56) >> shift;
+	}
+	entry.address = address;
+	entry.n = n;
+	entry.shift = shift;
+	entry.first_version = first_version;
+	entry.last_version = last_version;
+	return entry.rows;
+}
+
+template<bool HOOKED>
+uint8_t Chip8::draw_sprite_rows(uint16_t address, uint8_t n, uint8_t x, uint8_t y){
+	// XOR a sprite onto the display and return 1 if any lit pixel was
+	// turned off. Rows are drawn a whole word at a time.
+	uint8_t collision = 0;
+
+	// Plain CHIP-8: one plane, one word per row, sprites clip at the edges
+	if (machine == MACHINE_CHIP8){
+		int px = x & 63;
+		int py = y & 31;
+
+		// Reads of watched memory must reach the debugger, so skip the cache
+		const uint64_t *rows = NULL;
+		if (sprite_cache_enabled && n && !(HOOKED && watch_read_pages)){
+			rows = get_sprite_masks(address, n, px);
+		}
+
+		for (int j = 0; j < n && py+j < 32; ++j){
+			uint64_t row = rows ? rows[j] : ((uint64_t)read_memory<HOOKED>(address+j) << 56) >> px;
+			uint64_t dst = planes[0][py+j][0];
+
+			collision |= (dst & row) != 0;
+			store_display_word(0, py+j, 0, dst ^ row);
+		}
+		return collision;
+	}
+
+	// XO-CHIP: every selected plane in turn takes the next block of sprite
+	// data. n = 0 draws a 16x16 sprite. Sprites wrap around the edges.
+	int width = get_display_width();
+	int height = get_display_height();
+	int sprite_width = n ? 8 : 16;
+	int rows = n ? n : 16;
+	int px = x % width;
+	int py = y % height;
+
+	for (int plane = 0; plane < 2; ++plane){
+		if (!(plane_mask & (1 << plane))){
+			continue;
+		}
+
+		for (int j = 0; j < rows; ++j){
+			uint64_t bits = read_memory<HOOKED>(address);
+			if (sprite_width == 16){
+				bits = (bits << 8) | read_memory<HOOKED>(address+1);
+			}
+			address += sprite_width / 8;
+
+			// Left align the sprite row, then rotate it into place
+			uint64_t hi = bits << (64 - sprite_width);
+			uint64_t lo = 0;
+			int shift = px;
+
+			if (!hires){
+				hi = shift ? (hi >> shift) | (hi << (64 - shift)) : hi;
+			} else {
+				if (shift >= 64){
+					std::swap(hi, lo);
+					shift -= 64;
+				}
+				if (shift){
+					uint64_t new_hi = (hi >> shift) | (lo << (64 - shift));
+					uint64_t new_lo = (lo >> shift) | (hi << (64 - shift));
+					hi = new_hi;
+					lo = new_lo;
+				}
+			}
 
-		uint8_t aa = get_at_memory_address(address+j);
-		std::string binary = std::bitset<8>(aa).to_string();
+			int row = (py+j) % height;
+			uint64_t *dst = planes[plane][row];
+			collision |= ((dst[0] & hi) | (dst[1] & lo)) != 0;
+			store_display_word(plane, row, 0, dst[0] ^ hi);
+			store_display_word(plane, row, 1, dst[1] ^ lo);
+		}
+	}
+	return collision;
+}
 
-		for (int i = 0; i < 8; ++i){
-			int pixel_index = (x+y*get_display_width()) + (i + j*get_display_width());
-			if (binary[i] == '1'){
-				display[pixel_index] = (int)binary[i];
+void Chip8::clear_planes(){
+	for (int plane = 0; plane < 2; ++plane){
+		if (plane_mask & (1 << plane)){
+			for (int y = 0; y < 64; ++y){
+				store_display_word(plane, y, 0, 0);
+				store_display_word(plane, y, 1, 0);
 			}
 		}
 	}
 }
 
+void Chip8::scroll_down(int rows){
+	int height = get_display_height();
+
+	for (int plane = 0; plane < 2; ++plane){
+		if (!(plane_mask & (1 << plane))){
+			continue;
+		}
+		for (int y = height - 1; y >= 0; --y){
+			store_display_word(plane, y, 0, y >= rows ? planes[plane][y-rows][0] : 0);
+			store_display_word(plane, y, 1, y >= rows ? planes[plane][y-rows][1] : 0);
+		}
+	}
+}
+
+void Chip8::scroll_up(int rows){
+	int height = get_display_height();
+
+	for (int plane = 0; plane < 2; ++plane){
+		if (!(plane_mask & (1 << plane))){
+			continue;
+		}
+		for (int y = 0; y < height; ++y){
+			store_display_word(plane, y, 0, y + rows < height ? planes[plane][y+rows][0] : 0);
+			store_display_word(plane, y, 1, y + rows < height ? planes[plane][y+rows][1] : 0);
+		}
+	}
+}
+
+void Chip8::scroll_right(int pixels){
+	for (int plane = 0; plane < 2; ++plane){
+		if (!(plane_mask & (1 << plane))){
+			continue;
+		}
+		for (int y = 0; y < get_display_height(); ++y){
+			uint64_t *row = planes[plane][y];
+			if (hires){
+				store_display_word(plane, y, 1, (row[1] >> pixels) | (row[0] << (64 - pixels)));
+			}
+			store_display_word(plane, y, 0, row[0] >> pixels);
+		}
+	}
+}
+
+void Chip8::scroll_left(int pixels){
+	for (int plane = 0; plane < 2; ++plane){
+		if (!(plane_mask & (1 << plane))){
+			continue;
+		}
+		for (int y = 0; y < get_display_height(); ++y){
+			uint64_t *row = planes[plane][y];
+			store_display_word(plane, y, 0, (row[0] << pixels) | (hires ? row[1] >> (64 - pixels) : 0));
+			store_display_word(plane, y, 1, row[1] << pixels);
+		}
+	}
+}
+
 std::string debug_get_op_hex(uint16_t op){		
 	std::stringstream ss;
 
@@ -159,6 +628,89 @@ std::string debug_get_op_hex(uint16_t op){
 	return ss.str();
 }
 
+std::string debug_get_op_mnemonic(uint16_t op){
+	std::stringstream ss;
+	uint16_t nnn = op & 0x0FFF;
+	int x  = (op & 0x0F00) >> 8;
+	int y  = (op & 0x00F0) >> 4;
+	int n  = op & 0x000F;
+	int kk = op & 0x00FF;
+
+	ss << std::hex;
+	switch (op & 0xF000){
+		case 0x0000:
+			if (op == 0x00E0)		ss << "CLS";
+			else if (op == 0x00EE)	ss << "RET";
+			else if ((op & 0xFFF0) == 0x00C0)	ss << "SCD " << n;
+			else if ((op & 0xFFF0) == 0x00D0)	ss << "SCU " << n;
+			else if (op == 0x00FB)	ss << "SCR";
+			else if (op == 0x00FC)	ss << "SCL";
+			else if (op == 0x00FD)	ss << "EXIT";
+			else if (op == 0x00FE)	ss << "LOW";
+			else if (op == 0x00FF)	ss << "HIGH";
+			else					ss << "SYS 0x" << nnn;
+			break;
+		case 0x1000: ss << "JP 0x" << nnn; break;
+		case 0x2000: ss << "CALL 0x" << nnn; break;
+		case 0x3000: ss << "SE V" << x << ", 0x" << kk; break;
+		case 0x4000: ss << "SNE V" << x << ", 0x" << kk; break;
+		case 0x5000:
+			if (n == 0x2)			ss << "SAVE V" << x << " - V" << y;
+			else if (n == 0x3)		ss << "LOAD V" << x << " - V" << y;
+			else					ss << "SE V" << x << ", V" << y;
+			break;
+		case 0x6000: ss << "LD V" << x << ", 0x" << kk; break;
+		case 0x7000: ss << "ADD V" << x << ", 0x" << kk; break;
+		case 0x8000:
+			switch (n){
+				case 0x0: ss << "LD V" << x << ", V" << y; break;
+				case 0x1: ss << "OR V" << x << ", V" << y; break;
+				case 0x2: ss << "AND V" << x << ", V" << y; break;
+				case 0x3: ss << "XOR V" << x << ", V" << y; break;
+				case 0x4: ss << "ADD V" << x << ", V" << y; break;
+				case 0x5: ss << "SUB V" << x << ", V" << y; break;
+				case 0x6: ss << "SHR V" << x; break;
+				case 0x7: ss << "SUBN V" << x << ", V" << y; break;
+				case 0xE: ss << "SHL V" << x; break;
+				default:  ss << "DW 0x" << debug_get_op_hex(op); break;
+			}
+			break;
+		case 0x9000: ss << "SNE V" << x << ", V" << y; break;
+		case 0xA000: ss << "LD I, 0x" << nnn; break;
+		case 0xB000: ss << "JP V0, 0x" << nnn; break;
+		case 0xC000: ss << "RND V" << x << ", 0x" << kk; break;
+		case 0xD000: ss << "DRW V" << x << ", V" << y << ", " << n; break;
+		case 0xE000:
+			if (kk == 0x9E)			ss << "SKP V" << x;
+			else if (kk == 0xA1)	ss << "SKNP V" << x;
+			else					ss << "DW 0x" << debug_get_op_hex(op);
+			break;
+		case 0xF000:
+			if (op == 0xF000){
+				ss << "LD I, long";
+				break;
+			}
+			switch (kk){
+				case 0x01: ss << "PLANE " << x; break;
+				case 0x02: ss << "AUDIO"; break;
+				case 0x3A: ss << "PITCH V" << x; break;
+				case 0x07: ss << "LD V" << x << ", DT"; break;
+				case 0x0A: ss << "LD V" << x << ", K"; break;
+				case 0x15: ss << "LD DT, V" << x; break;
+				case 0x18: ss << "LD ST, V" << x; break;
+				case 0x1E: ss << "ADD I, V" << x; break;
+				case 0x29: ss << "LD F, V" << x; break;
+				case 0x33: ss << "LD B, V" << x; break;
+				case 0x55: ss << "LD [I], V" << x; break;
+				case 0x65: ss << "LD V" << x << ", [I]"; break;
+				default:   ss << "DW 0x" << debug_get_op_hex(op); break;
+			}
+			break;
+	}
+
+	return ss.str();
+}
+
 std::string debug_get_op_bin(uint16_t op){
 	std::stringstream ss;
 	std::bitset<16> x(op);
@@ -175,7 +727,7 @@ void Chip8::start(){
 	do{	
 		// Assign op to the current bytes at the program counter. 
 		// We shift the first byte and append the second to the new space.
-		op = (memory[PC] << 8) | memory[PC+1];
+		op = fetch_op(PC);
 		
 		// if (debug){
 			std::cout
@@ -185,70 +737,370 @@ void Chip8::start(){
 		// 		<< std::endl;
 		// }
 
-		// Interpret and carry out the instruction
-		interpret(op);
-
 		// Increment the program counter by 1 op (2 bytes)
 		PC += 2;
 
+		// Interpret and carry out the instruction
+		interpret(op);
+
 	} while(op != 0); // Continue until we reach null bytes.
 
 }
 
 int Chip8::execute_next_op(){
+	// Debug flags and watchpoints are rare, so ops are compiled twice and
+	// only the hooked copy checks for them
+	if (hooked){
+		return execute_op<true>();
+	}
+	return execute_op<false>();
+}
+
+template<bool HOOKED>
+int Chip8::execute_op(){
 	// Initialize op, our current instruction.
 	// Assign op to the current bytes at the program counter. 
 	// We shift the first byte and append the second to the new space.
-	uint16_t op = (memory[PC] << 8) | memory[PC+1];
-		
-	std::cout << debug_get_op_hex(op);
+	uint16_t op = fetch_op(PC);
 
-	// If we reach a NULL op, return 0 to signify end of exec
-	if (op == 0){
+	if (HOOKED && (debug & DEBUG_TRACE)){
+		std::cout << debug_get_op_hex(op);
+	}
+
+	// If we reach a NULL op (or XO-CHIP's 00FD exit), return 0 to signify end of exec
+	if (op == 0 || (op == 0x00FD && machine == MACHINE_XOCHIP)){
 		return 0;
 	}
 		
-	// Interpret and carry out the instruction
-	interpret(op);
-
-	// Increment the program counter by 1 op (2 bytes)
+	// Increment the program counter by 1 op (2 bytes) before interpreting,
+	// so jumps and calls can overwrite it
 	PC += 2;
 
+	// Interpret and carry out the instruction. While it runs the op count
+	// is this op's index.
+	interpret_op<HOOKED>(op);
+	executed_op_count++;
+
 	// Debug pause
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	if (HOOKED && (debug & DEBUG_PAUSE)){
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
 
 	// Return 1 to signify continued operation
 	return 1;
 
 }
 
+void Chip8::tick_timers(){
+	// Both timers count down at 60Hz until they reach 0
+	if (delay_timer > 0){
+		delay_timer--;
+	}
+	if (sound_timer > 0){
+		sound_timer--;
+	}
+}
+
+int Chip8::run_frame(int ops_per_frame){
+	// Execute one 60Hz frame worth of ops, then tick the timers.
+	// Returns 0 if execution ended during the frame.
+	int remaining = ops_per_frame;
+
+	while (remaining > 0){
+		// Timers and keys only change between frames, so a loop waiting on
+		// them spins until the frame ends. Skip its whole iterations and
+		// execute any partial one normally, leaving the same state behind.
+		if (idle_skip){
+			int loop_length = get_idle_loop_length();
+			if (loop_length && remaining >= loop_length){
+				int skipped = remaining - remaining % loop_length;
+
+				// Fx07 is the only loop op with a side effect
+				uint16_t op = fetch_op(PC);
+				if ((op & 0xF0FF) == 0xF007){
+					V[(op & 0x0F00) >> 8] = delay_timer;
+				}
+
+				skipped_op_count += skipped;
+				remaining -= skipped;
+				continue;
+			}
+		}
+
+		if (!execute_next_op()){
+			return 0;
+		}
+		remaining--;
+	}
+	tick_timers();
+
+	return 1;
+}
+
+int Chip8::run_ops(int max_ops){
+	// Execute up to max_ops ops, stopping early at the start of an idle
+	// loop so the caller can wait for whatever it is waiting on.
+	// Returns the number of ops executed, or -1 if execution ended.
+	int executed = 0;
+	while (executed < max_ops && !get_idle_loop_length()){
+		if (!execute_next_op()){
+			return -1;
+		}
+		executed++;
+	}
+	return executed;
+}
+
+int Chip8::execute_ops(int count){
+	// Execute count ops back to back, without idle skipping or timer ticks,
+	// for callers that keep their own op count.
+	// Returns the number of ops executed, fewer if execution ended.
+	for (int i = 0; i < count; ++i){
+		if (!execute_next_op()){
+			return i;
+		}
+	}
+	return count;
+}
+
+void Chip8::catch_up_timers(uint32_t frames){
+	// Same as frames calls to tick_timers
+	delay_timer = frames < delay_timer ? delay_timer - frames : 0;
+	sound_timer = frames < sound_timer ? sound_timer - frames : 0;
+}
+
+int Chip8::get_idle_loop_length(){
+	// Returns the length in ops of the loop starting at PC if it cannot
+	// exit before the next timer tick or key change, or 0 otherwise.
+	uint16_t op0 = fetch_op(PC);
+	uint16_t op1 = fetch_op(PC+2);
+	uint16_t op2 = fetch_op(PC+4);
+
+	// Fx0A - wait for a key press, re-executed while no key is down
+	if ((op0 & 0xF0FF) == 0xF00A){
+		for (int key = 0; key < 16; ++key){
+			if (keys[key]){
+				return 0;
+			}
+		}
+		return 1;
+	}
+
+	// JP only reaches the first 4K
+	if (PC > 0x0FFF){
+		return 0;
+	}
+	uint16_t jump_back = 0x1000 | PC;
+
+	// 1nnn - JP to itself
+	if (op0 == jump_back){
+		return 1;
+	}
+
+	// Ex9E/ExA1, 1nnn - wait for a key to be pressed or released
+	if (op1 == jump_back){
+		uint8_t key = keys[V[(op0 & 0x0F00) >> 8] & 0xF];
+
+		if ((op0 & 0xF0FF) == 0xE09E && !key){
+			return 2;
+		}
+		if ((op0 & 0xF0FF) == 0xE0A1 && key){
+			return 2;
+		}
+		return 0;
+	}
+
+	// Fx07, 3xkk/4xkk, 1nnn - wait for the delay timer to reach kk
+	if (op2 == jump_back
+		&& (op0 & 0xF0FF) == 0xF007
+		&& (op0 & 0x0F00) == (op1 & 0x0F00)){
+		uint8_t kk = op1 & 0x00FF;
+
+		if ((op1 & 0xF000) == 0x3000 && delay_timer != kk){
+			return 3;
+		}
+		if ((op1 & 0xF000) == 0x4000 && delay_timer == kk){
+			return 3;
+		}
+	}
+
+	return 0;
+}
+
+bool Chip8::get_idle_skip(){
+	return idle_skip;
+}
+void Chip8::set_idle_skip(bool enabled){
+	idle_skip = enabled;
+}
+
+bool Chip8::get_sprite_cache(){
+	return sprite_cache_enabled;
+}
+void Chip8::set_sprite_cache(bool enabled){
+	sprite_cache_enabled = enabled;
+}
+
+uint64_t Chip8::get_executed_op_count(){
+	return executed_op_count;
+}
+uint64_t Chip8::get_skipped_op_count(){
+	return skipped_op_count;
+}
+
+uint64_t Chip8::get_key_read_count(){
+	return key_read_count;
+}
+uint64_t Chip8::get_sprite_cache_hit_count(){
+	return sprite_cache_hit_count;
+}
+uint64_t Chip8::get_display_change_count(){
+	return display_change_count;
+}
+
+void Chip8::arm_latency_probe(){
+	probe_key_read_op = NO_PROBE_OP;
+	probe_display_change_op = NO_PROBE_OP;
+}
+uint64_t Chip8::get_probe_key_read_op(){
+	return probe_key_read_op;
+}
+uint64_t Chip8::get_probe_display_change_op(){
+	return probe_display_change_op;
+}
+
+uint64_t Chip8::get_memory_hash(){
+	return memory_hash;
+}
+uint64_t Chip8::get_display_hash(){
+	return display_hash;
+}
+
+uint64_t Chip8::get_state_hash(){
+	// Registers are few enough to fold in on demand
+	uint64_t h = hash_mix(memory_hash ^ hash_mix(display_hash));
+	for (int i = 0; i < 16; i += 8){
+		uint64_t v = 0;
+		for (int j = 0; j < 8; ++j){
+			v = (v << 8) | V[i+j];
+		}
+		h = hash_mix(h ^ v);
+	}
+	for (int i = 0; i < 16; i += 4){
+		h = hash_mix(h ^ ((uint64_t)stack[i] << 48 | (uint64_t)stack[i+1] << 32 | (uint64_t)stack[i+2] << 16 | stack[i+3]));
+	}
+	for (int i = 0; i < 16; i += 8){
+		uint64_t v = 0;
+		for (int j = 0; j < 8; ++j){
+			v = (v << 8) | audio_pattern[i+j];
+		}
+		h = hash_mix(h ^ v);
+	}
+	h = hash_mix(h ^ ((uint64_t)I << 48 | (uint64_t)PC << 32 | (uint64_t)SP << 24 | (uint64_t)delay_timer << 16 | (uint64_t)sound_timer << 8 | pitch));
+	return hash_mix(h ^ ((uint64_t)hires << 8 | plane_mask));
+}
+
+uint64_t Chip8::compute_state_hash(){
+	uint64_t incremental_memory = memory_hash;
+	uint64_t incremental_display = display_hash;
+
+	memory_hash = 0;
+	for (uint32_t address = 0; address < get_memory_size(); ++address){
+		memory_hash ^= memory_key(address, memory[address]);
+	}
+	display_hash = 0;
+	for (int plane = 0; plane < 2; ++plane){
+		for (int y = 0; y < 64; ++y){
+			display_hash ^= display_key(plane, y, 0, planes[plane][y][0]);
+			display_hash ^= display_key(plane, y, 1, planes[plane][y][1]);
+		}
+	}
+	uint64_t h = get_state_hash();
+
+	memory_hash = incremental_memory;
+	display_hash = incremental_display;
+	return h;
+}
+
 void Chip8::interpret(uint16_t op){
+	if (hooked){
+		interpret_op<true>(op);
+	}
+	else{
+		interpret_op<false>(op);
+	}
+}
+
+template<bool HOOKED>
+void Chip8::interpret_op(uint16_t op){
 
 	// 0000 - NULL
 	if (op == 0){
-		std::cout << " : NULL";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : NULL";
 	}
 
 	// 00E0 - CLS
 	// Clear the display.
 	else if ((op & 0xFFFF) == 0x00E0){
-		std::cout << " : Clear the display";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Clear the display";
 
-		fill_display(0);
+		clear_planes();
 	} 
 
 	// 00EE - RET
 	// Return from a subroutine.
 	else if (op == 0x00EE){
-		std::cout << " : Return from a subroutine";
-		// todo
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Return from a subroutine";
+
+		PC = pop_stack();
+	}
+
+	// 00Cn - SCD nibble (XO-CHIP)
+	// Scroll the selected planes down n rows.
+	else if ((op & 0xFFF0) == 0x00C0 && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Scroll down n rows";
+
+		scroll_down(op & 0x000F);
+	}
+
+	// 00Dn - SCU nibble (XO-CHIP)
+	// Scroll the selected planes up n rows.
+	else if ((op & 0xFFF0) == 0x00D0 && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Scroll up n rows";
+
+		scroll_up(op & 0x000F);
+	}
+
+	// 00FB - SCR (XO-CHIP)
+	// Scroll the selected planes right 4 pixels.
+	else if (op == 0x00FB && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Scroll right 4 pixels";
+
+		scroll_right(4);
+	}
+
+	// 00FC - SCL (XO-CHIP)
+	// Scroll the selected planes left 4 pixels.
+	else if (op == 0x00FC && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Scroll left 4 pixels";
+
+		scroll_left(4);
+	}
+
+	// 00FE - LOW / 00FF - HIGH (XO-CHIP)
+	// Switch to 64x32 or 128x64 and clear the display.
+	else if ((op == 0x00FE || op == 0x00FF) && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Switch display resolution";
+
+		hires = op == 0x00FF;
+		fill_display(0);
 	}
 
 	// 0nnn - SYS addr
 	// Jump to a machine code routine at nnn.
 	else if ((op & 0xF000) == 0x0){
 		uint16_t addr = op & 0x0FFF;
-		std::cout << " : Jump to a machine code routine at " << addr;
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Jump to a machine code routine at " << addr;
 		// This instruction is only used on the old computers on 
 		// which Chip-8 was originally implemented. It is ignored 
 		// by modern interpreters.
@@ -258,7 +1110,7 @@ void Chip8::interpret(uint16_t op){
 	// Jump to location nnn.
 	else if ((op & 0xF000) == 0x1000){
 		uint16_t addr = op & 0x0FFF;
-		std::cout << " : Jump to location " << addr;
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Jump to location " << addr;
 
 		PC = addr;
 	}
@@ -268,8 +1120,11 @@ void Chip8::interpret(uint16_t op){
 	// Call subroutine at nnn.
 	else if ((op & 0xF000) == 0x2000){
 		uint16_t addr = op & 0x0FFF;
-		std::cout << " : Call subroutine at " << addr;
-		// todo
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Call subroutine at " << addr;
+
+		// PC already points at the op after the call
+		push_stack(PC);
+		PC = addr;
 	}	
 
 	// 3xkk - SE Vx, byte
@@ -278,10 +1133,10 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x  = (op & 0x0F00) >> 8;
 		uint8_t kk = op & 0x00FF;
 
-		std::cout << " : Skip next instruction if Vx = kk";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Skip next instruction if Vx = kk";
 
 		if(V[x] == kk){
-			PC += 2;
+			skip_next_op();
 		}
 	}
 
@@ -291,10 +1146,38 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x  = (op & 0x0F00) >> 8;
 		uint8_t kk = op & 0x00FF;
 
-		std::cout << " : Skip next instruction if Vx != kk";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Skip next instruction if Vx != kk";
 
 		if(V[x] != kk){
-			PC += 2;
+			skip_next_op();
+		}
+	}
+
+	// 5xy2 - SAVE Vx - Vy (XO-CHIP)
+	// Store registers Vx through Vy in memory starting at location I.
+	else if ((op & 0xF00F) == 0x5002 && machine == MACHINE_XOCHIP){
+		uint8_t x = (op & 0x0F00) >> 8;
+		uint8_t y = (op & 0x00F0) >> 4;
+		int step = x <= y ? 1 : -1;
+
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Store registers Vx through Vy in memory starting at location I";
+
+		for (int i = 0; i <= std::abs(y - x); ++i){
+			write_memory<HOOKED>(I+i, V[x + i*step]);
+		}
+	}
+
+	// 5xy3 - LOAD Vx - Vy (XO-CHIP)
+	// Read registers Vx through Vy from memory starting at location I.
+	else if ((op & 0xF00F) == 0x5003 && machine == MACHINE_XOCHIP){
+		uint8_t x = (op & 0x0F00) >> 8;
+		uint8_t y = (op & 0x00F0) >> 4;
+		int step = x <= y ? 1 : -1;
+
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Read registers Vx through Vy from memory starting at location I";
+
+		for (int i = 0; i <= std::abs(y - x); ++i){
+			V[x + i*step] = read_memory<HOOKED>(I+i);
 		}
 	}
 
@@ -304,10 +1187,10 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Skip next instruction if Vx = Vy";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Skip next instruction if Vx = Vy";
 
 		if (V[x] == V[y]){
-			PC += 2;
+			skip_next_op();
 		}
 	}	
 
@@ -317,8 +1200,8 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x  = (op & 0x0F00) >> 8;
 		uint8_t kk = (op & 0x00FF);
 
-		std::cout << " : Set Vx = kk";
-		std::cout << " | V" << (int)x << " = " << (int)kk << std::endl;
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = kk";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " | V" << (int)x << " = " << (int)kk << std::endl;
 
 		V[x] = kk;
 	}
@@ -329,7 +1212,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x  = (op & 0x0F00) >> 8;
 		uint8_t kk = op & 0x00FF;
 
-		std::cout << " : Set Vx = Vx + kk" << "@V" << (int)x << "@" << (int)kk;
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx + kk" << "@V" << (int)x << "@" << (int)kk;
 
 		V[x] = V[x] + kk;
 	}
@@ -340,7 +1223,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vy";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vy";
 
 		V[x] = V[y];
 	}
@@ -351,7 +1234,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx OR Vy";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx OR Vy";
 
 		V[x] = V[x] | V[y];
 	}
@@ -362,7 +1245,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx AND Vy";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx AND Vy";
 
 		V[x] = V[x] & V[y];
 	}
@@ -373,7 +1256,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx XOR Vy";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx XOR Vy";
 		
 		V[x] = V[x] ^ V[y];
 	}
@@ -384,7 +1267,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx + Vy, set VF = carry";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx + Vy, set VF = carry";
 
 		V[x] = V[x] + V[y];
 		V[0xF] = 1;
@@ -396,7 +1279,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx - Vy, set VF = NOT borrow";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx - Vy, set VF = NOT borrow";
 
 		V[x] = V[x] - V[y];
 		V[0xF] = 0;
@@ -408,7 +1291,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx + kk";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx + kk";
 	}
 
 	// 8xy7 - SUBN Vx, Vy
@@ -417,7 +1300,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vy - Vx, set VF = NOT borrow";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vy - Vx, set VF = NOT borrow";
 	}
 
 	// 8xyE - SHL Vx {, Vy}
@@ -426,7 +1309,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Set Vx = Vx SHL 1";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = Vx SHL 1";
 	}
 
 	// 9xy0 - SNE Vx, Vy
@@ -435,10 +1318,10 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x = (op & 0x0F00) >> 8;
 		uint8_t y = (op & 0x00F0) >> 4;
 
-		std::cout << " : Skip next instruction if Vx != Vy";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Skip next instruction if Vx != Vy";
 
 		if (V[x] != V[y]){
-			PC += 2;
+			skip_next_op();
 		}
 	}
 
@@ -447,7 +1330,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF000) == 0xA000){
 		uint16_t addr = op & 0x0FFF;
 
-		std::cout << " : Set I = nnn";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set I = nnn";
 		// std::cout << std::dec << "@" << I << "@" << addr << "@" << (int)memory[I] << "@" << (int)memory[addr];
 
 		I = addr;
@@ -458,7 +1341,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF000) == 0xB000){
 		uint16_t addr = op & 0x0FFF;
 
-		std::cout << " : Jump to location nnn + V0";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Jump to location nnn + V0";
 
 		PC = addr + V[0];
 	}
@@ -469,7 +1352,7 @@ void Chip8::interpret(uint16_t op){
 		uint8_t x  = (op & 0x0F00) >> 8;
 		uint8_t kk = op & 0x00FF;
 
-		std::cout << " : Set Vx = random byte AND kk";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = random byte AND kk";
 		// todo
 	}
 
@@ -480,34 +1363,22 @@ void Chip8::interpret(uint16_t op){
 		uint8_t y = (op & 0x00F0) >> 4;
 		uint8_t n = op & 0x000F;
 
-		std::cout << " : Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision";
-
-		for (int j = 0; j < n; ++j){
-
-			uint8_t aa = get_at_memory_address(I+j);
-			std::string binary = std::bitset<8>(aa).to_string();
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision";
 
-			for (int i = 0; i < 8; ++i){
-				int pixel_index = (V[x]+V[y]*get_display_width()) + (i + j*get_display_width());
-
-				if((int)binary[i] && display[pixel_index]){
-					V[0xF] = 1;
-				}
-
-				if (binary[i] == '1'){
-					display[pixel_index] = (int)binary[i] ^ display[pixel_index];
-				}
-			}
-		}
+		V[0xF] = draw_sprite_rows<HOOKED>(I, n, V[x], V[y]);
 	}
 
 	// Ex9E - SKP Vx
 	// Skip next instruction if key with the value of Vx is pressed.
-	else if ((op & 0xF000) == 0xE09E){
+	else if ((op & 0xF0FF) == 0xE09E){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Skip next instruction if key with the value of Vx is pressed";
-		// todo
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Skip next instruction if key with the value of Vx is pressed";
+
+		note_key_read();
+		if (keys[V[x] & 0xF]){
+			skip_next_op();
+		}
 	}
 
 	// ExA1 - SKNP Vx
@@ -515,8 +1386,49 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xE0A1){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Skip next instruction if key with the value of Vx is not pressed";
-		// todo
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Skip next instruction if key with the value of Vx is not pressed";
+
+		note_key_read();
+		if (!keys[V[x] & 0xF]){
+			skip_next_op();
+		}
+	}
+
+	// F000 nnnn - LD I, long (XO-CHIP)
+	// Set I = the 16-bit word following this op.
+	else if (op == 0xF000 && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set I = nnnn";
+
+		I = fetch_op(PC);
+		PC += 2;
+	}
+
+	// Fn01 - PLANE n (XO-CHIP)
+	// Select the display planes drawn to.
+	else if ((op & 0xF0FF) == 0xF001 && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Select drawing planes";
+
+		plane_mask = (op & 0x0F00) >> 8 & 0x3;
+	}
+
+	// F002 - AUDIO (XO-CHIP)
+	// Load the 16 byte audio pattern buffer from memory starting at location I.
+	else if (op == 0xF002 && machine == MACHINE_XOCHIP){
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Load audio pattern";
+
+		for (int i = 0; i < 16; ++i){
+			audio_pattern[i] = read_memory<HOOKED>(I+i);
+		}
+	}
+
+	// Fx3A - PITCH Vx (XO-CHIP)
+	// Set the audio playback pitch = Vx.
+	else if ((op & 0xF0FF) == 0xF03A && machine == MACHINE_XOCHIP){
+		uint8_t x = (op & 0x0F00) >> 8;
+
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set pitch = Vx";
+
+		pitch = V[x];
 	}
 
 	// Fx07 - LD Vx, DT
@@ -524,7 +1436,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF007){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Set Vx = delay timer value";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set Vx = delay timer value";
 
 		V[x] = delay_timer;
 	}
@@ -534,8 +1446,18 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF00A){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Wait for a key press, store the value of the key in Vx";
-		// todo
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Wait for a key press, store the value of the key in Vx";
+
+		// Re-execute this op until a key is down
+		note_key_read();
+		PC -= 2;
+		for (uint8_t key = 0; key < 16; ++key){
+			if (keys[key]){
+				V[x] = key;
+				PC += 2;
+				break;
+			}
+		}
 	}
 
 	// Fx15 - LD DT, Vx
@@ -543,7 +1465,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF015){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Set delay timer = Vx";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set delay timer = Vx";
 
 		delay_timer = V[x];
 	}
@@ -553,7 +1475,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF018){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Set sound timer = Vx";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set sound timer = Vx";
 
 		sound_timer = V[x];
 	}
@@ -563,7 +1485,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF01E){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Set I = I + Vx";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set I = I + Vx";
 
 		I = I + V[x];
 	}
@@ -573,7 +1495,7 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF029){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Set I = location of sprite for digit Vx";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Set I = location of sprite for digit Vx";
 		// todo
 	}
 
@@ -582,8 +1504,11 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF033){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Store BCD representation of Vx in memory locations I, I+1, and I+2";
-		// todo
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Store BCD representation of Vx in memory locations I, I+1, and I+2";
+
+		write_memory<HOOKED>(I, V[x] / 100);
+		write_memory<HOOKED>(I+1, V[x] / 10 % 10);
+		write_memory<HOOKED>(I+2, V[x] % 10);
 	}
 
 	// Fx55 - LD [I], Vx
@@ -591,10 +1516,10 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF055){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Store registers V0 through Vx in memory starting at location I";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Store registers V0 through Vx in memory starting at location I";
 	
-		for (int i = 0; i < 0xF; ++i){
-			memory[I+i] = V[i];
+		for (int i = 0; i <= x; ++i){
+			write_memory<HOOKED>(I+i, V[i]);
 		}
 	}
 
@@ -603,12 +1528,12 @@ void Chip8::interpret(uint16_t op){
 	else if ((op & 0xF0FF) == 0xF065){
 		uint8_t x = (op & 0x0F00) >> 8;
 
-		std::cout << " : Read registers V0 through Vx from memory starting at location I";
+		if (HOOKED && (debug & DEBUG_TRACE)) std::cout << " : Read registers V0 through Vx from memory starting at location I";
 		
-		for (int i = 0; i < 0xF; ++i){
-			V[i] = memory[I+i];
+		for (int i = 0; i <= x; ++i){
+			V[i] = read_memory<HOOKED>(I+i);
 		}
 	}
 
-	std::cout << std::endl;	
+	if (HOOKED && (debug & DEBUG_TRACE)) std::cout << std::endl;	
 }
\ No newline at end of file
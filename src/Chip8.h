@@ -3,10 +3,38 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
+
+class Chip8Debugger;
+
+// Memory watchpoints are tracked per page, one bit each in a uint64_t,
+// so memory is split into 64 pages
+const int WATCH_PAGE_COUNT = 64;
+
+// Entries in the direct-mapped DRW row mask cache
+const int SPRITE_CACHE_BITS = 5;
+const int SPRITE_CACHE_SIZE = 1 << SPRITE_CACHE_BITS;
+
+// Latency probe op before the probed event has happened
+const uint64_t NO_PROBE_OP = UINT64_MAX;
+
+// Machine variants
+enum Chip8Machine{
+	MACHINE_CHIP8,				// 4K RAM, 64x32 single plane display
+	MACHINE_XOCHIP				// 64K RAM, 64x32/128x64 two plane display
+};
+
+// Bits of the debug mode flags
+enum Chip8DebugFlags{
+	DEBUG_TRACE = 0x01,			// Print every op as it is executed
+	DEBUG_PAUSE = 0x02			// Sleep after every op
+};
 
 class Chip8{
 private:
-	uint8_t	 memory[4096];		// RAM
+	Chip8Machine machine;		// Machine variant
+	uint16_t memory_mask;		// Memory size - 1, addresses wrap
+	uint32_t long_op;			// XO-CHIP's 4 byte F000, out of op range on CHIP-8
 	uint8_t  V[16];				// Multi-purpose registers. V[15] is reserved
 	uint16_t I;					// Address register
 	uint8_t  delay_timer;		// Delay timer
@@ -14,15 +42,86 @@ private:
 	uint16_t PC;				// Program counter
 	uint8_t  SP;				// Stack pointer
 	uint16_t stack[16];			// Call stack
-	uint8_t  display[64*32];	// Game display
+	uint64_t planes[2][64][2];	// Game display. Bit-packed planes, [plane][row][word], MSB leftmost
+	uint8_t  plane_mask;		// Planes drawn to by CLS, DRW and scrolls (XO-CHIP Fn01)
+	bool     hires;				// 128x64 rather than 64x32 (XO-CHIP 00FF)
+	uint8_t  audio_pattern[16];	// XO-CHIP 1-bit audio sample buffer
+	uint8_t  pitch;				// XO-CHIP audio playback pitch
+	uint8_t  keys[16];			// Hex keypad. Non-zero when pressed
+	uint32_t key_version;		// Bumped whenever the keypad is changed
 	uint8_t  debug;				// Debug mode flags
+	bool     hooked;			// Debug flags or watched pages set, so ops check for them
+	bool     idle_skip;			// Fast-forward detected idle loops in run_frame
+	uint64_t executed_op_count;	// Ops interpreted, the index of the running op during one
+	uint64_t skipped_op_count;	// Ops fast-forwarded by idle loop detection
+	uint64_t key_read_count;	// Ops that read the keypad
+	uint64_t display_change_count;	// Ops that changed the display
+	uint64_t display_change_op;		// Executed op count of the last op that did
+	uint64_t probe_key_read_op;		// Executed op count at the first key read since arming
+	uint64_t probe_display_change_op;	// And at the first display change after that read
+
+	uint64_t watch_read_pages;	// Pages holding a read watchpoint
+	uint64_t watch_write_pages;	// Pages holding a write watchpoint
+	Chip8Debugger *debugger;	// Notified of accesses to watched pages
+	int watch_page_shift;		// Address to watch page shift
+
+	uint64_t memory_hash;		// XOR of per-byte keys, kept current by store_memory
+
+	// A sprite's rows expanded and shifted into display words, valid while
+	// the versions of the pages holding its first and last byte are unchanged
+	struct SpriteCacheEntry{
+		uint16_t address;
+		uint8_t  n;				// 0 for an empty entry
+		uint8_t  shift;			// x mod 64
+		uint32_t first_version;
+		uint32_t last_version;
+		uint64_t rows[15];
+	};
+	bool     sprite_cache_enabled;	// Use the cache for CHIP-8 DRW
+	uint64_t sprite_cache_hit_count;
+	uint32_t page_versions[WATCH_PAGE_COUNT];	// Bumped by every write to the page
+	SpriteCacheEntry sprite_cache[SPRITE_CACHE_SIZE];
+	uint64_t display_hash;		// XOR of per-word keys, kept current by store_display_word
+
+	uint8_t *memory;			// RAM: inline_memory, or extended_memory on XO-CHIP
+	uint8_t *extended_memory;	// XO-CHIP's 64K, on the heap. NULL on CHIP-8
+
+	// Last, so XO-CHIP copies can stop before it
+	uint8_t  inline_memory[0x1000];	// CHIP-8's 4K RAM, unused on XO-CHIP
 
 	void init_registers();
+	void copy_from(const Chip8 &other);
+	void update_hooked();
+	template<bool HOOKED> uint8_t read_memory(uint16_t address);
+	template<bool HOOKED> void write_memory(uint16_t address, uint8_t value);
+	uint16_t fetch_op(uint16_t address);
+	void skip_next_op();
+	void note_key_read();
+	void store_memory(uint16_t address, uint8_t value);
+	void store_display_word(int plane, int y, int word, uint64_t value);
+	const uint64_t* get_sprite_masks(uint16_t address, uint8_t n, uint8_t shift);
+
+	template<bool HOOKED> uint8_t draw_sprite_rows(uint16_t address, uint8_t n, uint8_t x, uint8_t y);
+	template<bool HOOKED> int execute_op();
+	template<bool HOOKED> void interpret_op(uint16_t op);
+	void clear_planes();
+	void scroll_down(int rows);
+	void scroll_up(int rows);
+	void scroll_right(int pixels);
+	void scroll_left(int pixels);
 
 public:
-	Chip8();
+	Chip8(Chip8Machine machine = MACHINE_CHIP8);
+	Chip8(const Chip8 &other);
+	Chip8& operator=(const Chip8 &other);
 	~Chip8();
 
+	Chip8Machine get_machine();
+	uint32_t get_memory_size() const;
+
+	void reset();
+	int load_rom(const uint8_t *rom, uint16_t length);
+
 	uint8_t get_at_memory_address(uint16_t address);
 	void set_memory_address(uint16_t address, uint8_t value);
 	void set_memory_block(uint16_t address, uint8_t *value, uint16_t length);
@@ -52,19 +151,72 @@ public:
 	void push_stack(uint16_t address);
 	uint16_t pop_stack();
 
-	uint8_t* get_display();
+	uint8_t get_display_pixel(int x, int y);
+	const uint64_t* get_display_row(int plane, int y);
 	void set_display_pixel(uint16_t index, uint8_t value);
 	void set_display_block(uint16_t index, uint8_t value, uint16_t length);
 	void fill_display(uint8_t value);
 	int get_display_width();
 	int get_display_height();
+	bool get_hires();
+	uint8_t get_plane_mask();
+
+	const uint8_t* get_audio_pattern();
+	uint8_t get_pitch();
+
+	uint8_t get_key(uint8_t index);
+	void set_key(uint8_t index, uint8_t pressed);
+	void release_all_keys();
+	uint32_t get_key_version();
+
+	uint8_t get_debug();
+	void set_debug(uint8_t flags);
+
+	Chip8Debugger* get_debugger();
+	void set_debugger(Chip8Debugger *debugger);
+	void set_watch_pages(uint64_t read_pages, uint64_t write_pages);
+	int get_watch_page_shift();
 
 	void draw_sprite(uint16_t address, uint8_t length, uint8_t x, uint8_t y);
 	void start();
 	int execute_next_op();
-	
+	int execute_ops(int count);
+	void tick_timers();
+	int run_frame(int ops_per_frame);
+	int run_ops(int max_ops);
+	void catch_up_timers(uint32_t frames);
+
+	int get_idle_loop_length();
+	bool get_idle_skip();
+	void set_idle_skip(bool enabled);
+	bool get_sprite_cache();
+	void set_sprite_cache(bool enabled);
+	uint64_t get_executed_op_count();
+	uint64_t get_skipped_op_count();
+	uint64_t get_key_read_count();
+	uint64_t get_sprite_cache_hit_count();
+	uint64_t get_display_change_count();
+
+	// Marks the first key read from now on, and the first display change
+	// after it, with the executed op count they happened at. NO_PROBE_OP
+	// until they happen.
+	void arm_latency_probe();
+	uint64_t get_probe_key_read_op();
+	uint64_t get_probe_display_change_op();
+
+	// Hash of the whole machine state except the keypad, O(1) to read.
+	// compute_state_hash rebuilds it from scratch to check the incremental one.
+	uint64_t get_state_hash();
+	uint64_t compute_state_hash();
+	uint64_t get_memory_hash();
+	uint64_t get_display_hash();
+
 	void interpret(uint16_t op);
 
 };
 
+// Formatting helpers for tracing and tools
+std::string debug_get_op_hex(uint16_t op);
+std::string debug_get_op_mnemonic(uint16_t op);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "Chip8Coroutine.h"
+#include <utility>
+
+
+const uint64_t NEVER = UINT64_MAX;
+
+// co_await'ed by chip8_run to hand its wait to whoever resumes it
+struct Chip8Suspend{
+	Chip8WaitReason reason;
+	uint32_t frames;
+
+	bool await_ready(){ return false; }
+	void await_suspend(std::coroutine_handle<Chip8Task::promise_type> handle){
+		handle.promise().reason = reason;
+		handle.promise().frames = frames;
+	}
+	void await_resume(){}
+};
+
+
+Chip8Task::Chip8Task(std::coroutine_handle<promise_type> handle){
+	this->handle = handle;
+}
+
+Chip8Task::Chip8Task(Chip8Task &&other) noexcept{
+	handle = std::exchange(other.handle, nullptr);
+}
+
+Chip8Task& Chip8Task::operator=(Chip8Task &&other) noexcept{
+	if (this != &other){
+		if (handle){
+			handle.destroy();
+		}
+		handle = std::exchange(other.handle, nullptr);
+	}
+	return *this;
+}
+
+Chip8Task::~Chip8Task(){
+	if (handle){
+		handle.destroy();
+	}
+}
+
+void Chip8Task::resume(){
+	if (handle && !handle.done()){
+		handle.resume();
+	}
+}
+
+Chip8WaitReason Chip8Task::get_wait_reason(){
+	return handle ? handle.promise().reason : WAIT_HALT;
+}
+
+uint32_t Chip8Task::get_wait_frames(){
+	return handle ? handle.promise().frames : 0;
+}
+
+
+// What the idle loop at PC waits for. For delay timer polls, frames is
+// set to how many ticks until the loop can exit.
+static Chip8WaitReason get_idle_wait(Chip8 *chip8, uint32_t &frames){
+	uint16_t PC = chip8->get_PC();
+	uint16_t op0 = chip8->get_at_memory_address(PC) << 8 | chip8->get_at_memory_address(PC+1);
+	uint16_t op1 = chip8->get_at_memory_address(PC+2) << 8 | chip8->get_at_memory_address(PC+3);
+	int length = chip8->get_idle_loop_length();
+	frames = 0;
+
+	if (length == 2 || (op0 & 0xF0FF) == 0xF00A){
+		return WAIT_KEY;
+	}
+
+	// 3xkk spins while DT != kk and 4xkk while DT == kk. DT only counts
+	// down, so some of these never exit.
+	if (length == 3){
+		uint8_t dt = chip8->get_delay_timer();
+		uint8_t kk = op1 & 0x00FF;
+		if ((op1 & 0xF000) == 0x3000 && dt > kk){
+			frames = dt - kk;
+			return WAIT_TIMER;
+		}
+		if ((op1 & 0xF000) == 0x4000 && dt > 0){
+			frames = 1;
+			return WAIT_TIMER;
+		}
+	}
+
+	// JP to itself, or a timer value that will never come
+	return WAIT_HALT;
+}
+
+Chip8Task chip8_run(Chip8 *chip8, int ops_per_frame){
+	while (true){
+		int remaining = ops_per_frame;
+		while (remaining > 0){
+			int executed = chip8->run_ops(remaining);
+			if (executed < 0){
+				co_return;
+			}
+			remaining -= executed;
+
+			// Stopped at an idle loop, which would spin out the frame
+			if (remaining > 0){
+				uint32_t frames;
+				Chip8WaitReason reason = get_idle_wait(chip8, frames);
+				co_await Chip8Suspend{reason, frames};
+				remaining = ops_per_frame;
+			}
+		}
+		co_await Chip8Suspend{WAIT_FRAME, 1};
+	}
+}
+
+
+Chip8Scheduler::Chip8Scheduler(int ops_per_frame){
+	this->ops_per_frame = ops_per_frame;
+	frame = 0;
+	resume_count = 0;
+}
+
+int Chip8Scheduler::add(Chip8 *chip8){
+	Session session{chip8, chip8_run(chip8, ops_per_frame), frame, frame};
+	sessions.push_back(std::move(session));
+	wakeups.push(Wakeup(frame, (int) sessions.size() - 1));
+	return (int) sessions.size() - 1;
+}
+
+void Chip8Scheduler::schedule(int index){
+	Session &session = sessions[index];
+	Chip8WaitReason reason = session.task.get_wait_reason();
+
+	if (reason == WAIT_FRAME || reason == WAIT_TIMER){
+		session.resume_frame = frame + session.task.get_wait_frames();
+		wakeups.push(Wakeup(session.resume_frame, index));
+	} else {
+		session.resume_frame = NEVER;
+	}
+}
+
+void Chip8Scheduler::set_key(int index, uint8_t key, uint8_t pressed){
+	Session &session = sessions[index];
+	session.chip8->set_key(key, pressed);
+
+	// It re-checks its keys when resumed, and waits again if need be
+	if (session.task.get_wait_reason() == WAIT_KEY && session.resume_frame == NEVER){
+		session.resume_frame = frame;
+		wakeups.push(Wakeup(frame, index));
+	}
+}
+
+int Chip8Scheduler::run_frame(){
+	int ran = 0;
+	while (!wakeups.empty() && wakeups.top().first <= frame){
+		int index = wakeups.top().second;
+		wakeups.pop();
+
+		sync_timers(index);
+		sessions[index].task.resume();
+		schedule(index);
+
+		resume_count++;
+		ran++;
+	}
+	frame++;
+	return ran;
+}
+
+void Chip8Scheduler::sync_timers(int index){
+	Session &session = sessions[index];
+	session.chip8->catch_up_timers(frame - session.timer_frame);
+	session.timer_frame = frame;
+}
+
+int Chip8Scheduler::get_session_count(){
+	return (int) sessions.size();
+}
+uint64_t Chip8Scheduler::get_frame(){
+	return frame;
+}
+Chip8WaitReason Chip8Scheduler::get_wait_reason(int index){
+	return sessions[index].task.get_wait_reason();
+}
+uint64_t Chip8Scheduler::get_resume_count(){
+	return resume_count;
+}
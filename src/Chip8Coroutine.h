@@ -0,0 +1,102 @@
+#ifndef CHIP8_COROUTINE_H
+#define CHIP8_COROUTINE_H
+
+#include "Chip8.h"
+#include <coroutine>
+#include <functional>
+#include <queue>
+#include <stdint.h>
+#include <vector>
+
+// What a suspended machine is waiting for
+enum Chip8WaitReason{
+	WAIT_START,			// Not run yet
+	WAIT_FRAME,			// The next frame, after using up this one's ops
+	WAIT_TIMER,			// The delay timer to reach a polled value
+	WAIT_KEY,			// A key press or release
+	WAIT_HALT			// Nothing, it ended or spins forever
+};
+
+// A machine's run loop as a coroutine. It runs ops until the frame's
+// budget is used up or it reaches a loop waiting on the keypad or delay
+// timer, then suspends saying what it waits for and for how many frames.
+class Chip8Task{
+public:
+	struct promise_type{
+		Chip8WaitReason reason = WAIT_START;
+		uint32_t frames = 0;					// Frames to wait for WAIT_FRAME and WAIT_TIMER
+
+		Chip8Task get_return_object(){
+			return Chip8Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void(){ reason = WAIT_HALT; }
+		void unhandled_exception(){ throw; }
+	};
+
+	Chip8Task(Chip8Task &&other) noexcept;
+	Chip8Task& operator=(Chip8Task &&other) noexcept;
+	~Chip8Task();
+
+	// Runs until the next suspension. Does nothing once halted.
+	void resume();
+	Chip8WaitReason get_wait_reason();
+	uint32_t get_wait_frames();
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	explicit Chip8Task(std::coroutine_handle<promise_type> handle);
+};
+
+Chip8Task chip8_run(Chip8 *chip8, int ops_per_frame);
+
+// Interleaves many machines on one thread. Each frame only the machines
+// whose wait is over are resumed. A machine waiting on its keypad costs
+// nothing until set_key wakes it, and one polling the delay timer sleeps
+// until the frame the timer reaches its value. Timers are caught up by
+// the frames slept whenever a machine resumes, so between resumes they
+// read as they were when it suspended.
+class Chip8Scheduler{
+private:
+	struct Session{
+		Chip8     *chip8;
+		Chip8Task  task;
+		uint64_t   resume_frame;		// Frame to resume on, NEVER while waiting on keys
+		uint64_t   timer_frame;			// Frame the timers are ticked up to
+	};
+
+	// Resume queue entry, earliest frame first
+	typedef std::pair<uint64_t, int> Wakeup;
+
+	int ops_per_frame;
+	uint64_t frame;						// Frame the next run_frame runs
+	std::vector<Session> sessions;
+	std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup> > wakeups;
+	uint64_t resume_count;
+
+	void schedule(int index);
+
+public:
+	Chip8Scheduler(int ops_per_frame);
+
+	// Returns the session index. The machine must outlive the scheduler.
+	int add(Chip8 *chip8);
+
+	// Sets a key and wakes the session if it waits on its keypad
+	void set_key(int index, uint8_t key, uint8_t pressed);
+
+	// Runs one frame of every session that is due. Returns how many ran.
+	int run_frame();
+
+	// Brings a sleeping session's timers up to date, e.g. to read them
+	void sync_timers(int index);
+
+	int get_session_count();
+	uint64_t get_frame();
+	Chip8WaitReason get_wait_reason(int index);
+	uint64_t get_resume_count();
+};
+
+#endif
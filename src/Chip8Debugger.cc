@@ -0,0 +1,371 @@
+#include "Chip8Debugger.h"
+#include <algorithm>
+
+
+Chip8Debugger::Chip8Debugger(Chip8 *chip8, int ops_per_frame, uint64_t snapshot_interval, size_t max_snapshots){
+	this->chip8 = chip8;
+	this->ops_per_frame = ops_per_frame;
+	this->snapshot_interval = snapshot_interval ? snapshot_interval : 1;
+	this->max_snapshots = max_snapshots ? max_snapshots : 1;
+	frame_op = 0;
+	op_count = 0;
+	breakpoint_count = 0;
+	watching = false;
+	watch_hit = STOP_NONE;
+	stop_address = 0;
+	replaying = false;
+	snapshot_first = 0;
+	snapshot_count = 0;
+	next_snapshot_op = 0;
+	snapshots.reserve(this->max_snapshots);
+	key_version = chip8->get_key_version();
+
+	address_mask = chip8->get_memory_size() - 1;
+	breakpoints.assign(chip8->get_memory_size(), false);
+	read_watchpoints.assign(chip8->get_memory_size(), false);
+	write_watchpoints.assign(chip8->get_memory_size(), false);
+
+	chip8->set_debugger(this);
+}
+
+Chip8Debugger::~Chip8Debugger(){
+	chip8->set_debugger(NULL);
+}
+
+
+void Chip8Debugger::add_breakpoint(uint16_t address){
+	if (!breakpoints[address & address_mask]){
+		breakpoints[address & address_mask] = true;
+		breakpoint_count++;
+	}
+}
+void Chip8Debugger::remove_breakpoint(uint16_t address){
+	if (breakpoints[address & address_mask]){
+		breakpoints[address & address_mask] = false;
+		breakpoint_count--;
+	}
+}
+
+void Chip8Debugger::add_watchpoint(uint16_t address, uint8_t kinds){
+	if (kinds & WATCH_READ){
+		read_watchpoints[address & address_mask] = true;
+	}
+	if (kinds & WATCH_WRITE){
+		write_watchpoints[address & address_mask] = true;
+	}
+	update_watch_pages();
+}
+void Chip8Debugger::remove_watchpoint(uint16_t address){
+	read_watchpoints[address & address_mask] = false;
+	write_watchpoints[address & address_mask] = false;
+	update_watch_pages();
+}
+
+void Chip8Debugger::add_register_change(uint8_t index){
+	RegisterCondition condition = {index, true, 0, get_register(index)};
+	conditions.push_back(condition);
+}
+void Chip8Debugger::add_register_equals(uint8_t index, uint16_t value){
+	RegisterCondition condition = {index, false, value, get_register(index)};
+	conditions.push_back(condition);
+}
+void Chip8Debugger::clear_register_conditions(){
+	conditions.clear();
+}
+
+void Chip8Debugger::clear_all(){
+	std::fill(breakpoints.begin(), breakpoints.end(), false);
+	breakpoint_count = 0;
+	std::fill(read_watchpoints.begin(), read_watchpoints.end(), false);
+	std::fill(write_watchpoints.begin(), write_watchpoints.end(), false);
+	update_watch_pages();
+	conditions.clear();
+}
+
+bool Chip8Debugger::is_armed(){
+	return breakpoint_count > 0
+		|| watching
+		|| !conditions.empty();
+}
+
+
+uint16_t Chip8Debugger::get_register(uint8_t index){
+	if (index == REGISTER_I){
+		return chip8->get_I();
+	}
+	return chip8->get_V(index & 0xF);
+}
+
+void Chip8Debugger::update_watch_pages(){
+	// Fold the watched addresses down to one bit per page for the core
+	uint64_t read_pages = 0;
+	uint64_t write_pages = 0;
+
+	int shift = chip8->get_watch_page_shift();
+
+	for (size_t i = 0; i < read_watchpoints.size(); ++i){
+		if (read_watchpoints[i]){
+			read_pages |= 1ull << (i >> shift);
+		}
+		if (write_watchpoints[i]){
+			write_pages |= 1ull << (i >> shift);
+		}
+	}
+	watching = read_pages || write_pages;
+	chip8->set_watch_pages(read_pages, write_pages);
+}
+
+void Chip8Debugger::on_memory_access(uint16_t address, bool write){
+	if (replaying || watch_hit != STOP_NONE){
+		return;
+	}
+
+	if (write && write_watchpoints[address & address_mask]){
+		watch_hit = STOP_WATCH_WRITE;
+		stop_address = address;
+	}
+	else if (!write && read_watchpoints[address & address_mask]){
+		watch_hit = STOP_WATCH_READ;
+		stop_address = address;
+	}
+}
+
+uint16_t Chip8Debugger::get_key_mask(){
+	uint16_t keys = 0;
+	for (int i = 0; i < 16; ++i){
+		keys |= (chip8->get_key(i) ? 1 : 0) << i;
+	}
+	return keys;
+}
+
+void Chip8Debugger::set_key_mask(uint16_t keys){
+	for (int i = 0; i < 16; ++i){
+		chip8->set_key(i, (keys >> i) & 1);
+	}
+}
+
+void Chip8Debugger::record_key_input(){
+	// The keypad only changes between our calls, so checking the version
+	// at the start of each is enough to see every change
+	if (chip8->get_key_version() == key_version){
+		return;
+	}
+	key_version = chip8->get_key_version();
+
+	KeyInput input = {op_count, get_key_mask()};
+	if (!key_inputs.empty() && key_inputs.back().op_count == op_count){
+		key_inputs.back() = input;
+	} else {
+		key_inputs.push_back(input);
+	}
+}
+
+Chip8Debugger::Snapshot& Chip8Debugger::get_snapshot(size_t index){
+	return snapshots[(snapshot_first + index) % max_snapshots];
+}
+
+void Chip8Debugger::take_snapshot(){
+	// Replace a snapshot of this same op, else append, overwriting the
+	// oldest once full. Slots are copied into rather than reallocated.
+	if (snapshot_count && get_snapshot(snapshot_count - 1).op_count == op_count){
+		snapshot_count--;
+	}
+	else if (snapshot_count == max_snapshots){
+		snapshot_first = (snapshot_first + 1) % max_snapshots;
+		snapshot_count--;
+	}
+
+	size_t slot = (snapshot_first + snapshot_count) % max_snapshots;
+	if (slot == snapshots.size()){
+		Snapshot snapshot = {op_count, frame_op, *chip8};
+		snapshots.push_back(snapshot);
+	}
+	else{
+		Snapshot &snapshot = snapshots[slot];
+		snapshot.op_count = op_count;
+		snapshot.frame_op = frame_op;
+		snapshot.state = *chip8;
+	}
+	snapshot_count++;
+	next_snapshot_op = op_count + snapshot_interval;
+
+	// The oldest snapshot holds the keypad as of its op, so older inputs
+	// can't be replayed any more
+	uint64_t oldest = get_snapshot(0).op_count;
+	while (!key_inputs.empty() && key_inputs.front().op_count <= oldest){
+		key_inputs.pop_front();
+	}
+}
+
+void Chip8Debugger::take_snapshot_if_due(){
+	// Snapshot periodically. Keypad changes in between are replayed from
+	// key_inputs.
+	if (snapshot_count && op_count < next_snapshot_op){
+		return;
+	}
+	take_snapshot();
+}
+
+int Chip8Debugger::execute_op(){
+	// Timers tick at the end of every frame, as in Chip8::run_frame
+	if (!chip8->execute_next_op()){
+		return 0;
+	}
+
+	op_count++;
+	frame_op++;
+	if (frame_op >= ops_per_frame){
+		chip8->tick_timers();
+		frame_op = 0;
+	}
+	return 1;
+}
+
+
+Chip8StopReason Chip8Debugger::step(){
+	record_key_input();
+	take_snapshot_if_due();
+
+	for (size_t i = 0; i < conditions.size(); ++i){
+		conditions[i].last = get_register(conditions[i].index);
+	}
+
+	watch_hit = STOP_NONE;
+	if (!execute_op()){
+		return STOP_HALT;
+	}
+
+	if (watch_hit != STOP_NONE){
+		return watch_hit;
+	}
+
+	for (size_t i = 0; i < conditions.size(); ++i){
+		RegisterCondition &condition = conditions[i];
+		uint16_t value = get_register(condition.index);
+
+		if (condition.on_change ? value != condition.last : value == condition.value && value != condition.last){
+			stop_address = chip8->get_PC();
+			return STOP_REGISTER;
+		}
+	}
+
+	if (breakpoint_count && breakpoints[chip8->get_PC() & address_mask]){
+		stop_address = chip8->get_PC();
+		return STOP_BREAKPOINT;
+	}
+
+	return STOP_NONE;
+}
+
+Chip8StopReason Chip8Debugger::run(uint64_t max_ops){
+	// With nothing armed no op can stop us, so only keep up the snapshots.
+	// The keypad can't change while we run, so after the first check whole
+	// frames run as in run_frame up to the next snapshot.
+	if (!is_armed()){
+		record_key_input();
+		take_snapshot_if_due();
+		uint64_t end = op_count + max_ops;
+
+		while (op_count < end){
+			uint64_t stop = std::min(end, next_snapshot_op);
+
+			// Whole frames, or else the rest of one
+			int count = ops_per_frame - frame_op;
+			uint64_t frames = frame_op == 0 ? (stop - op_count) / ops_per_frame : 0;
+			for (uint64_t i = 0; i < frames; ++i){
+				int executed = chip8->execute_ops(count);
+				if (executed < count){
+					op_count += i * count + executed;
+					frame_op = executed;
+					return STOP_HALT;
+				}
+				chip8->tick_timers();
+			}
+			op_count += frames * count;
+
+			if (!frames){
+				count = (int) std::min<uint64_t>(count, stop - op_count);
+				int executed = chip8->execute_ops(count);
+				op_count += executed;
+				frame_op += executed;
+				if (executed < count){
+					return STOP_HALT;
+				}
+				if (frame_op >= ops_per_frame){
+					chip8->tick_timers();
+					frame_op = 0;
+				}
+			}
+
+			if (op_count >= next_snapshot_op){
+				take_snapshot();
+			}
+		}
+		return STOP_NONE;
+	}
+
+	for (uint64_t i = 0; i < max_ops; ++i){
+		Chip8StopReason reason = step();
+		if (reason != STOP_NONE){
+			return reason;
+		}
+	}
+	return STOP_NONE;
+}
+
+bool Chip8Debugger::step_back(){
+	if (op_count == 0 || snapshot_count == 0 || get_snapshot(0).op_count >= op_count){
+		return false;
+	}
+	uint64_t target = op_count - 1;
+
+	// Drop snapshots from after the target, then restore the latest one left
+	while (get_snapshot(snapshot_count - 1).op_count > target){
+		snapshot_count--;
+	}
+	Snapshot &snapshot = get_snapshot(snapshot_count - 1);
+	next_snapshot_op = snapshot.op_count + snapshot_interval;
+
+	*chip8 = snapshot.state;
+	op_count = snapshot.op_count;
+	frame_op = snapshot.frame_op;
+	update_watch_pages();
+
+	// Re-execute forward without triggering watchpoints, setting the
+	// keypad as it was set the first time round
+	std::deque<KeyInput>::iterator input = key_inputs.begin();
+	while (input != key_inputs.end() && input->op_count <= op_count){
+		++input;
+	}
+
+	bool replayed = true;
+	replaying = true;
+	while (true){
+		while (input != key_inputs.end() && input->op_count <= op_count){
+			set_key_mask(input->keys);
+			++input;
+		}
+		if (op_count >= target){
+			break;
+		}
+		if (!execute_op()){
+			replayed = false;
+			break;
+		}
+	}
+	replaying = false;
+
+	// Inputs after the op we stopped at are no longer part of the history
+	key_inputs.erase(input, key_inputs.end());
+	key_version = chip8->get_key_version();
+
+	return replayed;
+}
+
+
+uint64_t Chip8Debugger::get_op_count(){
+	return op_count;
+}
+uint16_t Chip8Debugger::get_stop_address(){
+	return stop_address;
+}
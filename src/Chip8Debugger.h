@@ -0,0 +1,115 @@
+#ifndef CHIP8_DEBUGGER_H
+#define CHIP8_DEBUGGER_H
+
+#include "Chip8.h"
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+// Why execution stopped
+enum Chip8StopReason{
+	STOP_NONE,			// Ran the requested number of ops
+	STOP_BREAKPOINT,	// PC reached a breakpoint
+	STOP_WATCH_READ,	// An op read a watched address
+	STOP_WATCH_WRITE,	// An op wrote a watched address
+	STOP_REGISTER,		// A register condition was met
+	STOP_HALT			// The machine reached a NULL op
+};
+
+// Bits for add_watchpoint
+enum Chip8WatchKind{
+	WATCH_READ  = 0x01,
+	WATCH_WRITE = 0x02
+};
+
+// Register index for register conditions on I. V0-VF are 0x0-0xF.
+const uint8_t REGISTER_I = 16;
+
+class Chip8Debugger{
+private:
+	// A copy of the machine taken before op number op_count
+	struct Snapshot{
+		uint64_t op_count;
+		int      frame_op;
+		Chip8    state;
+	};
+
+	// The keypad as set from op op_count on, one bit per key
+	struct KeyInput{
+		uint64_t op_count;
+		uint16_t keys;
+	};
+
+	// Stop when a register changes, or when it becomes equal to value
+	struct RegisterCondition{
+		uint8_t  index;
+		bool     on_change;
+		uint16_t value;
+		uint16_t last;
+	};
+
+	Chip8 *chip8;
+	int ops_per_frame;					// Timers tick after this many ops
+	int frame_op;						// Ops executed in the current frame
+	uint64_t op_count;					// Ops executed since attaching
+
+	uint16_t address_mask;				// Machine memory size - 1
+	std::vector<bool> breakpoints;		// One flag per address
+	std::vector<bool> read_watchpoints;
+	std::vector<bool> write_watchpoints;
+	std::vector<RegisterCondition> conditions;
+	int breakpoint_count;
+	bool watching;						// Any read or write watchpoint set
+
+	Chip8StopReason watch_hit;			// Set by on_memory_access during an op
+	uint16_t stop_address;				// Breakpoint or watched address that stopped us
+	bool replaying;						// Ignore watchpoints while re-executing
+
+	uint64_t snapshot_interval;			// Ops between periodic snapshots
+	size_t max_snapshots;				// Oldest snapshots are overwritten beyond this
+	std::vector<Snapshot> snapshots;	// Ring buffer, grows to max_snapshots then reuses slots
+	size_t snapshot_first;				// Slot of the oldest snapshot
+	size_t snapshot_count;
+	uint64_t next_snapshot_op;			// Op count the next periodic snapshot is due at
+	std::deque<KeyInput> key_inputs;	// Keypad changes after the oldest snapshot, replayed by step_back
+	uint32_t key_version;				// Machine keypad version last recorded
+
+	uint16_t get_register(uint8_t index);
+	void update_watch_pages();
+	uint16_t get_key_mask();
+	void set_key_mask(uint16_t keys);
+	void record_key_input();
+	Snapshot& get_snapshot(size_t index);
+	void take_snapshot();
+	void take_snapshot_if_due();
+	int execute_op();
+
+public:
+	Chip8Debugger(Chip8 *chip8, int ops_per_frame, uint64_t snapshot_interval = 262144, size_t max_snapshots = 64);
+	~Chip8Debugger();
+
+	void add_breakpoint(uint16_t address);
+	void remove_breakpoint(uint16_t address);
+
+	void add_watchpoint(uint16_t address, uint8_t kinds);
+	void remove_watchpoint(uint16_t address);
+
+	void add_register_change(uint8_t index);
+	void add_register_equals(uint8_t index, uint16_t value);
+	void clear_register_conditions();
+
+	void clear_all();
+	bool is_armed();
+
+	Chip8StopReason step();
+	Chip8StopReason run(uint64_t max_ops);
+	bool step_back();
+
+	uint64_t get_op_count();
+	uint16_t get_stop_address();
+
+	// Called by Chip8 on accesses to a watched page
+	void on_memory_access(uint16_t address, bool write);
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "Chip8Env.h"
+#include "Chip8.h"
+#include <algorithm>
+#include <new>
+#include <vector>
+
+
+const uint16_t ROM_OFFSET = 0x200;
+const uint32_t MAX_ROM_LENGTH = 4096 - ROM_OFFSET;
+const uint32_t DEFAULT_OPS_PER_FRAME = 10;
+
+struct Chip8EnvBatch{
+	Chip8 initial;							// Freshly loaded machine every env resets to
+	std::vector<Chip8> envs;				// One machine per environment
+	std::vector<uint32_t> scores;			// Score seen at the end of the last step
+	std::vector<uint8_t> done;				// Non-zero once the env has halted
+	std::vector<uint16_t> reward_addresses;	// RAM bytes making up the score
+	uint32_t ops_per_frame;
+	uint32_t obs_format;
+};
+
+
+static uint32_t read_score(Chip8EnvBatch *batch, Chip8 *chip8){
+	uint32_t score = 0;
+	for (size_t i = 0; i < batch->reward_addresses.size(); ++i){
+		score += chip8->get_at_memory_address(batch->reward_addresses[i]);
+	}
+	return score;
+}
+
+static void write_observation(Chip8EnvBatch *batch, Chip8 *chip8, uint8_t *out){
+	// Display rows are already bit-packed, MSB leftmost
+	for (int y = 0; y < 32; ++y){
+		uint64_t row = chip8->get_display_row(0, y)[0];
+
+		if (batch->obs_format == CHIP8_OBS_PACKED){
+			for (int i = 0; i < 8; ++i){
+				out[y*8 + i] = (uint8_t) (row >> (56 - 8*i));
+			}
+		} else {
+			for (int x = 0; x < 64; ++x){
+				out[y*64 + x] = (row >> (63 - x)) & 1;
+			}
+		}
+	}
+}
+
+static void reset_env(Chip8EnvBatch *batch, uint32_t index, uint8_t *observation){
+	// Copy assignment keeps this allocation free
+	batch->envs[index] = batch->initial;
+	batch->scores[index] = read_score(batch, &batch->envs[index]);
+	batch->done[index] = 0;
+
+	if (observation){
+		write_observation(batch, &batch->envs[index], observation);
+	}
+}
+
+
+extern "C" {
+
+uint32_t chip8_env_abi_version(void){
+	return CHIP8_ENV_ABI_VERSION;
+}
+
+Chip8EnvBatch* chip8_env_create(uint32_t env_count, const Chip8EnvConfig *config){
+	if (!config || !config->rom || config->rom_length == 0 || config->rom_length > MAX_ROM_LENGTH){
+		return NULL;
+	}
+	if (config->obs_format != CHIP8_OBS_UINT8 && config->obs_format != CHIP8_OBS_PACKED){
+		return NULL;
+	}
+	if (config->reward_address_count && !config->reward_addresses){
+		return NULL;
+	}
+	for (uint32_t i = 0; i < config->reward_address_count; ++i){
+		if (config->reward_addresses[i] >= 4096){
+			return NULL;
+		}
+	}
+
+	Chip8EnvBatch *batch = new (std::nothrow) Chip8EnvBatch;
+	if (!batch){
+		return NULL;
+	}
+
+	// Exceptions must not cross the C boundary
+	try{
+		batch->ops_per_frame = config->ops_per_frame ? config->ops_per_frame : DEFAULT_OPS_PER_FRAME;
+		batch->obs_format = config->obs_format;
+		batch->reward_addresses.assign(
+			config->reward_addresses,
+			config->reward_addresses + config->reward_address_count);
+
+		batch->initial.set_memory_block(
+			ROM_OFFSET,
+			const_cast<uint8_t*>(config->rom),
+			(uint16_t) config->rom_length);
+
+		batch->envs.assign(env_count, batch->initial);
+		batch->scores.assign(env_count, 0);
+		batch->done.assign(env_count, 0);
+	} catch (...){
+		delete batch;
+		return NULL;
+	}
+
+	chip8_env_reset(batch, NULL);
+	return batch;
+}
+
+void chip8_env_destroy(Chip8EnvBatch *batch){
+	delete batch;
+}
+
+uint32_t chip8_env_count(const Chip8EnvBatch *batch){
+	return (uint32_t) batch->envs.size();
+}
+
+uint32_t chip8_env_observation_size(const Chip8EnvBatch *batch){
+	uint32_t pixels = 64*32;
+	return batch->obs_format == CHIP8_OBS_PACKED ? pixels/8 : pixels;
+}
+
+void chip8_env_reset(Chip8EnvBatch *batch, uint8_t *observations){
+	uint32_t obs_size = chip8_env_observation_size(batch);
+
+	for (uint32_t i = 0; i < batch->envs.size(); ++i){
+		reset_env(batch, i, observations ? observations + i*obs_size : NULL);
+	}
+}
+
+void chip8_env_reset_one(Chip8EnvBatch *batch, uint32_t index, uint8_t *observation){
+	if (index >= batch->envs.size()){
+		return;
+	}
+	reset_env(batch, index, observation);
+}
+
+void chip8_env_step_batch(
+	Chip8EnvBatch *batch,
+	const int32_t *actions,
+	uint32_t n_frames,
+	uint8_t *observations,
+	float *rewards,
+	uint8_t *dones){
+
+	uint32_t obs_size = chip8_env_observation_size(batch);
+
+	for (uint32_t i = 0; i < batch->envs.size(); ++i){
+		Chip8 *chip8 = &batch->envs[i];
+
+		// Hold the chosen key for the whole step
+		chip8->release_all_keys();
+		if (actions && actions[i] >= 0 && actions[i] < 16){
+			chip8->set_key((uint8_t) actions[i], 1);
+		}
+
+		for (uint32_t f = 0; f < n_frames && !batch->done[i]; ++f){
+			if (!chip8->run_frame(batch->ops_per_frame)){
+				batch->done[i] = 1;
+			}
+		}
+
+		uint32_t score = read_score(batch, chip8);
+		if (rewards){
+			rewards[i] = (float) ((int64_t) score - (int64_t) batch->scores[i]);
+		}
+		batch->scores[i] = score;
+
+		if (dones){
+			dones[i] = batch->done[i];
+		}
+		if (observations){
+			write_observation(batch, chip8, observations + i*obs_size);
+		}
+	}
+}
+
+void chip8_env_state_hashes(Chip8EnvBatch *batch, uint64_t *hashes){
+	for (uint32_t i = 0; i < batch->envs.size(); ++i){
+		hashes[i] = batch->envs[i].get_state_hash();
+	}
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef CHIP8_ENV_H
+#define CHIP8_ENV_H
+
+// C ABI for driving batches of Chip8 machines from other languages
+// (Python ctypes/cffi, etc.) as reinforcement learning environments.
+//
+// All buffers are owned by the caller and written in place, so stepping
+// a batch never allocates.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_ENV_ABI_VERSION 1
+
+// Observation layouts written by reset and step
+#define CHIP8_OBS_UINT8		0	// One byte per pixel, 0 or 1, row major
+#define CHIP8_OBS_PACKED	1	// One bit per pixel, MSB is the leftmost pixel
+
+// Action value meaning "no key pressed"
+#define CHIP8_ACTION_NONE	-1
+
+typedef struct Chip8EnvBatch Chip8EnvBatch;
+
+typedef struct Chip8EnvConfig{
+	const uint8_t  *rom;					// ROM image, loaded at 0x200
+	uint32_t        rom_length;				// ROM size in bytes
+	uint32_t        ops_per_frame;			// Ops per 60Hz frame, 0 for the default
+	uint32_t        obs_format;				// CHIP8_OBS_UINT8 or CHIP8_OBS_PACKED
+	const uint16_t *reward_addresses;		// RAM bytes summed into the score
+	uint32_t        reward_address_count;	// Number of reward addresses
+} Chip8EnvConfig;
+
+uint32_t chip8_env_abi_version(void);
+
+// Returns NULL if the config is invalid or allocation fails.
+Chip8EnvBatch* chip8_env_create(uint32_t env_count, const Chip8EnvConfig *config);
+void chip8_env_destroy(Chip8EnvBatch *batch);
+
+uint32_t chip8_env_count(const Chip8EnvBatch *batch);
+
+// Bytes written per environment into an observation buffer
+uint32_t chip8_env_observation_size(const Chip8EnvBatch *batch);
+
+// Reset every environment. observations may be NULL, otherwise it must
+// hold env_count * chip8_env_observation_size() bytes.
+void chip8_env_reset(Chip8EnvBatch *batch, uint8_t *observations);
+
+// Reset a single environment, e.g. after it reports done.
+// observation may be NULL, otherwise it receives that environment's frame.
+void chip8_env_reset_one(Chip8EnvBatch *batch, uint32_t index, uint8_t *observation);
+
+// Hold key actions[i] (0x0-0xF, or CHIP8_ACTION_NONE) on environment i for
+// n_frames frames. rewards[i] receives the change in score over the step
+// and dones[i] is set once the environment has halted. observations,
+// rewards and dones may each be NULL.
+void chip8_env_step_batch(
+	Chip8EnvBatch *batch,
+	const int32_t *actions,
+	uint32_t n_frames,
+	uint8_t *observations,
+	float *rewards,
+	uint8_t *dones);
+
+// Write one state hash per environment into hashes (env_count entries).
+// Equal hashes mean equal machine state, keypad aside, so divergence
+// between runs can be found without comparing memory.
+void chip8_env_state_hashes(Chip8EnvBatch *batch, uint64_t *hashes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#include "Chip8Profiler.h"
+#include <iomanip>
+#include <sstream>
+
+
+// The shadow stack stops growing here, e.g. for runaway recursion
+const int MAX_PROFILE_DEPTH = 64;
+
+Chip8Profiler::Chip8Profiler(Chip8 *chip8){
+	this->chip8 = chip8;
+	address_mask = chip8->get_memory_size() - 1;
+	reset();
+}
+
+void Chip8Profiler::reset(){
+	CallNode root;
+	root.entry = 0x200;
+	root.parent = -1;
+	root.ops = 0;
+	root.pixels = 0;
+
+	nodes.clear();
+	nodes.push_back(root);
+	current = 0;
+	depth = 0;
+	overflow_depth = 0;
+	hits.assign(chip8->get_memory_size(), 0);
+	entries.assign(chip8->get_memory_size(), false);
+}
+
+
+int Chip8Profiler::execute_next_op(){
+	uint16_t pc = chip8->get_PC() & address_mask;
+	uint16_t op = (chip8->get_at_memory_address(pc) << 8) | chip8->get_at_memory_address(pc+1);
+
+	if (!chip8->execute_next_op()){
+		return 0;
+	}
+
+	hits[pc]++;
+	nodes[current].ops++;
+
+	// Dxyn - charge the sprite's pixels on every selected plane. Dxy0 is
+	// a 16x16 sprite on XO-CHIP and draws nothing on CHIP-8.
+	if ((op & 0xF000) == 0xD000){
+		uint8_t mask = chip8->get_plane_mask();
+		int planes = (mask & 1) + ((mask >> 1) & 1);
+		int n = op & 0x000F;
+		if (n){
+			nodes[current].pixels += 8 * n * planes;
+		} else if (chip8->get_machine() == MACHINE_XOCHIP){
+			nodes[current].pixels += 16 * 16 * planes;
+		}
+	}
+
+	// 2nnn - CALL enters the callee's node for this path. Past the depth
+	// cap calls stay in the current node, and so do their RETs.
+	else if ((op & 0xF000) == 0x2000){
+		uint16_t addr = op & 0x0FFF;
+		entries[addr] = true;
+
+		if (depth >= MAX_PROFILE_DEPTH){
+			overflow_depth++;
+			return 1;
+		}
+
+		std::map<uint16_t, int>::iterator child = nodes[current].children.find(addr);
+		if (child != nodes[current].children.end()){
+			current = child->second;
+		} else {
+			CallNode node;
+			node.entry = addr;
+			node.parent = current;
+			node.ops = 0;
+			node.pixels = 0;
+			nodes.push_back(node);
+
+			int index = nodes.size() - 1;
+			nodes[current].children[addr] = index;
+			current = index;
+		}
+		depth++;
+	}
+
+	// 00EE - RET goes back to the caller
+	else if (op == 0x00EE && overflow_depth > 0){
+		overflow_depth--;
+	}
+	else if (op == 0x00EE && nodes[current].parent >= 0){
+		current = nodes[current].parent;
+		depth--;
+	}
+
+	return 1;
+}
+
+int Chip8Profiler::run_frame(int ops_per_frame){
+	for (int i = 0; i < ops_per_frame; ++i){
+		if (!execute_next_op()){
+			return 0;
+		}
+	}
+	chip8->tick_timers();
+
+	return 1;
+}
+
+uint64_t Chip8Profiler::get_hits(uint16_t address){
+	return hits[address & address_mask];
+}
+
+
+std::string Chip8Profiler::node_name(int index){
+	if (nodes[index].parent < 0){
+		return "main";
+	}
+
+	std::stringstream ss;
+	ss << "sub_" << std::hex << nodes[index].entry;
+	return ss.str();
+}
+
+void Chip8Profiler::write_folded_node(std::ostream &out, int index, std::string path, Chip8ProfileMetric metric){
+	CallNode &node = nodes[index];
+	path += node_name(index);
+
+	uint64_t count = metric == PROFILE_PIXELS ? node.pixels : node.ops;
+	if (count){
+		out << path << " " << std::dec << count << "\n";
+	}
+
+	for (std::map<uint16_t, int>::iterator it = node.children.begin(); it != node.children.end(); ++it){
+		write_folded_node(out, it->second, path + ";", metric);
+	}
+}
+
+void Chip8Profiler::write_folded(std::ostream &out, Chip8ProfileMetric metric){
+	write_folded_node(out, 0, "", metric);
+}
+
+void Chip8Profiler::write_annotated_disassembly(std::ostream &out){
+	int last = -1;
+
+	for (int address = 0; address < (int) hits.size(); ++address){
+		if (!hits[address]){
+			continue;
+		}
+
+		// Label subroutines and mark skipped ranges of code
+		if (entries[address]){
+			out << "\n" << "sub_" << std::hex << address << ":\n";
+		} else if (last >= 0 && address != last + 2){
+			out << "...\n";
+		}
+		last = address;
+
+		uint16_t op = (chip8->get_at_memory_address(address) << 8) | chip8->get_at_memory_address(address+1);
+		out << std::dec << std::setw(12) << hits[address]
+			<< "  " << std::hex << std::setw(3) << std::setfill('0') << address << std::setfill(' ')
+			<< "  " << debug_get_op_hex(op)
+			<< "  " << debug_get_op_mnemonic(op) << "\n";
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef CHIP8_PROFILER_H
+#define CHIP8_PROFILER_H
+
+#include "Chip8.h"
+#include <map>
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+// What the folded stack output counts
+enum Chip8ProfileMetric{
+	PROFILE_OPS,		// Ops executed
+	PROFILE_PIXELS		// Sprite pixels processed by DRW
+};
+
+// Exact guest-level profiler. Runs the machine itself, keeping a shadow
+// call stack from CALL/RET and charging every op to the guest subroutine
+// executing it, so the core pays nothing when not profiling.
+class Chip8Profiler{
+private:
+	// One node per distinct call path
+	struct CallNode{
+		uint16_t entry;						// Subroutine address, 0x200 for the root
+		int      parent;					// Index of the caller's node, -1 for the root
+		uint64_t ops;						// Ops executed in this path itself
+		uint64_t pixels;					// DRW pixels in this path itself
+		std::map<uint16_t, int> children;	// Callee address to node index
+	};
+
+	Chip8 *chip8;
+	std::vector<CallNode> nodes;
+	int current;							// Node of the running subroutine
+	int depth;
+	int overflow_depth;						// Calls past MAX_PROFILE_DEPTH, whose RETs don't pop
+	uint16_t address_mask;					// Machine memory size - 1
+	std::vector<uint64_t> hits;				// Ops executed per address
+	std::vector<bool> entries;				// Addresses that have been called
+
+	std::string node_name(int index);
+	void write_folded_node(std::ostream &out, int index, std::string path, Chip8ProfileMetric metric);
+
+public:
+	Chip8Profiler(Chip8 *chip8);
+
+	void reset();
+
+	int execute_next_op();
+	int run_frame(int ops_per_frame);
+
+	uint64_t get_hits(uint16_t address);
+
+	// One line per call path, "main;sub_2a4;sub_300 count", for flamegraph tools
+	void write_folded(std::ostream &out, Chip8ProfileMetric metric);
+
+	// Every executed address with its hit count and disassembly
+	void write_annotated_disassembly(std::ostream &out);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "LatencyTracker.h"
+#include <iomanip>
+
+
+static const char* SPAN_NAMES[SPAN_COUNT] = {
+	"receive->apply",
+	"apply->observe",
+	"observe->draw",
+	"draw->present",
+	"total"
+};
+
+
+LatencyTracker::LatencyTracker(double frame_period){
+	this->frame_period = frame_period;
+
+	received = -1;
+	applied = -1;
+	observed = -1;
+	drawn = -1;
+
+	frame_start = -1;
+	frame_start_op = 0;
+
+	for (int i = 0; i < SPAN_COUNT; ++i){
+		spans[i].buckets.assign(HISTOGRAM_BUCKETS, 0);
+		spans[i].count = 0;
+		spans[i].max = 0;
+	}
+	abandoned_count = 0;
+
+	last_present = -1;
+	frame_count = 0;
+	missed_frame_count = 0;
+}
+
+void LatencyTracker::add_sample(LatencySpan span, double seconds){
+	Histogram &histogram = spans[span];
+	int bucket = seconds > 0 ? (int) (seconds / HISTOGRAM_RESOLUTION) : 0;
+	if (bucket >= HISTOGRAM_BUCKETS){
+		bucket = HISTOGRAM_BUCKETS - 1;
+	}
+	histogram.buckets[bucket]++;
+	histogram.count++;
+	if (seconds > histogram.max){
+		histogram.max = seconds;
+	}
+}
+
+double LatencyTracker::get_op_time(Chip8 *chip8, uint64_t op, double now){
+	// The end of the op, assuming the burst's executed ops took equally long
+	uint64_t ops = chip8->get_executed_op_count() - frame_start_op;
+	if (frame_start < 0 || ops == 0 || op < frame_start_op){
+		return now;
+	}
+	return frame_start + (now - frame_start) * (op - frame_start_op + 1) / ops;
+}
+
+
+void LatencyTracker::key_received(double now){
+	if (received >= 0){
+		abandoned_count++;
+	}
+	received = now;
+	applied = -1;
+	observed = -1;
+	drawn = -1;
+}
+
+void LatencyTracker::key_applied(Chip8 *chip8, double now){
+	if (received >= 0 && applied < 0){
+		applied = now;
+		chip8->arm_latency_probe();
+	}
+}
+
+void LatencyTracker::frame_started(Chip8 *chip8, double now){
+	frame_start = now;
+	frame_start_op = chip8->get_executed_op_count();
+}
+
+void LatencyTracker::frame_emulated(Chip8 *chip8, double now){
+	uint64_t read_op = chip8->get_probe_key_read_op();
+	if (applied >= 0 && observed < 0 && read_op != NO_PROBE_OP){
+		observed = get_op_time(chip8, read_op, now);
+	}
+	uint64_t change_op = chip8->get_probe_display_change_op();
+	if (observed >= 0 && drawn < 0 && change_op != NO_PROBE_OP){
+		drawn = get_op_time(chip8, change_op, now);
+	}
+	frame_start = -1;
+}
+
+void LatencyTracker::frame_presented(double now){
+	if (last_present >= 0 && now - last_present > frame_period * 1.5){
+		missed_frame_count++;
+	}
+	last_present = now;
+	frame_count++;
+
+	if (drawn >= 0){
+		add_sample(SPAN_APPLY, applied - received);
+		add_sample(SPAN_OBSERVE, observed - applied);
+		add_sample(SPAN_DRAW, drawn - observed);
+		add_sample(SPAN_PRESENT, now - drawn);
+		add_sample(SPAN_TOTAL, now - received);
+		received = -1;
+		applied = -1;
+		observed = -1;
+		drawn = -1;
+	}
+}
+
+
+uint64_t LatencyTracker::get_sample_count(){
+	return spans[SPAN_TOTAL].count;
+}
+uint64_t LatencyTracker::get_abandoned_count(){
+	return abandoned_count;
+}
+uint64_t LatencyTracker::get_frame_count(){
+	return frame_count;
+}
+uint64_t LatencyTracker::get_missed_frame_count(){
+	return missed_frame_count;
+}
+
+double LatencyTracker::get_percentile(LatencySpan span, double p){
+	// Upper edge of the bucket holding the sample at rank p
+	Histogram &histogram = spans[span];
+	if (histogram.count == 0){
+		return 0;
+	}
+	uint64_t rank = (uint64_t) (p / 100 * histogram.count + 0.5);
+	if (rank < 1){
+		rank = 1;
+	}
+	uint64_t seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i){
+		seen += histogram.buckets[i];
+		if (seen >= rank){
+			double edge = (i + 1) * HISTOGRAM_RESOLUTION;
+			return edge < histogram.max ? edge : histogram.max;
+		}
+	}
+	return histogram.max;
+}
+
+double LatencyTracker::get_max(LatencySpan span){
+	return spans[span].max;
+}
+
+void LatencyTracker::write_report(std::ostream &out){
+	out << "Input latency over " << get_sample_count() << " key presses ("
+		<< abandoned_count << " abandoned), ms:" << std::endl;
+	out << std::fixed << std::setprecision(2);
+	for (int i = 0; i < SPAN_COUNT; ++i){
+		LatencySpan span = (LatencySpan) i;
+		out << "  " << std::left << std::setw(16) << SPAN_NAMES[i] << std::right
+			<< " p50 " << std::setw(7) << get_percentile(span, 50) * 1000
+			<< "  p99 " << std::setw(7) << get_percentile(span, 99) * 1000
+			<< "  max " << std::setw(7) << get_max(span) * 1000 << std::endl;
+	}
+	out << "Missed vsync on " << missed_frame_count << " of " << frame_count << " frames" << std::endl;
+	out << std::defaultfloat;
+}
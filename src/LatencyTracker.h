@@ -0,0 +1,83 @@
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include "Chip8.h"
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+// Spans between the pipeline stages a key press goes through
+enum LatencySpan{
+	SPAN_APPLY,			// Event received to keypad updated
+	SPAN_OBSERVE,		// Keypad updated to the first op reading it
+	SPAN_DRAW,			// That op to the display changing
+	SPAN_PRESENT,		// Display changing to the frame being presented
+	SPAN_TOTAL,			// Event received to frame presented
+	SPAN_COUNT
+};
+
+// Follows key presses through the frontend and the machine to the screen
+// and keeps a latency histogram per span. The frontend reports each stage
+// with a timestamp in seconds; the machine's latency probe gives the ops
+// at which the guest read the key and then changed the display. Ops run
+// in a burst between frame_started and frame_emulated, so those ops are
+// timed by where they fall among the burst's executed ops.
+//
+// One press is followed at a time. A new press replaces one that has
+// not reached the screen yet, which is counted as abandoned.
+class LatencyTracker{
+private:
+	// Histogram buckets, HISTOGRAM_BUCKETS of HISTOGRAM_RESOLUTION seconds,
+	// the last also holding everything longer
+	static const int HISTOGRAM_BUCKETS = 2000;
+	static constexpr double HISTOGRAM_RESOLUTION = 0.0001;
+
+	struct Histogram{
+		std::vector<uint64_t> buckets;
+		uint64_t count;
+		double max;
+	};
+
+	// Stage times of the press being followed, negative until reached
+	double received;
+	double applied;
+	double observed;
+	double drawn;
+
+	double frame_start;					// Time the current burst started, negative if unknown
+	uint64_t frame_start_op;			// Executed op count when it started
+
+	Histogram spans[SPAN_COUNT];
+	uint64_t abandoned_count;
+
+	double frame_period;				// Expected time between presents
+	double last_present;				// Negative before the first
+	uint64_t frame_count;
+	uint64_t missed_frame_count;		// Presents later than a frame and a half
+
+	void add_sample(LatencySpan span, double seconds);
+	double get_op_time(Chip8 *chip8, uint64_t op, double now);
+
+public:
+	LatencyTracker(double frame_period);
+
+	void key_received(double now);
+	void key_applied(Chip8 *chip8, double now);
+	void frame_started(Chip8 *chip8, double now);
+	void frame_emulated(Chip8 *chip8, double now);
+	void frame_presented(double now);
+
+	uint64_t get_sample_count();
+	uint64_t get_abandoned_count();
+	uint64_t get_frame_count();
+	uint64_t get_missed_frame_count();
+
+	// Percentile p (0-100) and maximum of a span, in seconds
+	double get_percentile(LatencySpan span, double p);
+	double get_max(LatencySpan span);
+
+	// p50/p99/max of every span in milliseconds, and the vsync misses
+	void write_report(std::ostream &out);
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "RomLoader.h"
+#include <fstream>
+#include <iterator>
+
+
+RomLoader::RomLoader(size_t prefetch_depth, size_t max_rom_size){
+	this->prefetch_depth = prefetch_depth ? prefetch_depth : 1;
+	this->max_rom_size = max_rom_size;
+	loading = 0;
+	stopping = false;
+	worker = std::thread(&RomLoader::run, this);
+}
+
+RomLoader::~RomLoader(){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+
+bool RomLoader::load_rom_file(const std::string &path, size_t max_rom_size, std::vector<uint8_t> &data, std::string &error){
+	std::ifstream is(path, std::ifstream::binary);
+	if (!is){
+		error = "could not open file";
+		return false;
+	}
+
+	data.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+	if (data.empty()){
+		error = "file is empty";
+		return false;
+	}
+	if (data.size() > max_rom_size){
+		error = "file is larger than " + std::to_string(max_rom_size) + " bytes";
+		return false;
+	}
+
+	return true;
+}
+
+void RomLoader::run(){
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true){
+		changed.wait(lock, [this]{
+			return stopping || (!pending.empty() && ready.size() < prefetch_depth);
+		});
+		if (stopping){
+			return;
+		}
+
+		Rom rom;
+		rom.path = pending.front();
+		pending.pop_front();
+		loading++;
+
+		// Do the disk work without holding the lock
+		lock.unlock();
+		std::string error;
+		bool ok = load_rom_file(rom.path, max_rom_size, rom.data, error);
+		lock.lock();
+
+		loading--;
+		if (ok){
+			ready.push_back(std::move(rom));
+		} else {
+			errors.push_back(rom.path + ": " + error);
+		}
+		changed.notify_all();
+	}
+}
+
+
+void RomLoader::enqueue(const std::string &path){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back(path);
+	}
+	changed.notify_all();
+}
+
+bool RomLoader::take_next(Rom &rom){
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (ready.empty()){
+			return false;
+		}
+		rom = std::move(ready.front());
+		ready.pop_front();
+	}
+
+	// Let the worker refill the prefetch queue
+	changed.notify_all();
+	return true;
+}
+
+bool RomLoader::wait_next(Rom &rom){
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this]{
+			return !ready.empty() || (pending.empty() && loading == 0);
+		});
+		if (ready.empty()){
+			return false;
+		}
+		rom = std::move(ready.front());
+		ready.pop_front();
+	}
+
+	changed.notify_all();
+	return true;
+}
+
+size_t RomLoader::get_ready_count(){
+	std::lock_guard<std::mutex> lock(mutex);
+	return ready.size();
+}
+
+std::vector<std::string> RomLoader::take_errors(){
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::string> taken;
+	taken.swap(errors);
+	return taken;
+}
@@ -0,0 +1,56 @@
+#ifndef ROM_LOADER_H
+#define ROM_LOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A ROM image read from disk and checked to fit the machine
+struct Rom{
+	std::string path;
+	std::vector<uint8_t> data;
+};
+
+// Reads and validates ROMs on a background thread, keeping up to
+// prefetch_depth of them ready so the caller can swap between titles
+// without touching the disk.
+class RomLoader{
+private:
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::deque<std::string> pending;	// Paths waiting to be read
+	std::deque<Rom> ready;				// Validated ROMs waiting to be taken
+	std::vector<std::string> errors;	// Paths that failed to load, with reasons
+	size_t prefetch_depth;
+	size_t max_rom_size;				// Largest ROM that fits the machine
+	int loading;						// Paths currently being read by the worker
+	bool stopping;
+
+	void run();
+
+public:
+	RomLoader(size_t prefetch_depth = 2, size_t max_rom_size = 4096 - 0x200);
+	~RomLoader();
+
+	void enqueue(const std::string &path);
+
+	// Non-blocking. Returns false if no ROM is ready yet.
+	bool take_next(Rom &rom);
+
+	// Blocks until a ROM is ready. Returns false if the queue ran dry.
+	bool wait_next(Rom &rom);
+
+	size_t get_ready_count();
+	std::vector<std::string> take_errors();
+
+	// Read and validate a ROM synchronously
+	static bool load_rom_file(const std::string &path, size_t max_rom_size, std::vector<uint8_t> &data, std::string &error);
+};
+
+#endif
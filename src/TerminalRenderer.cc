@@ -0,0 +1,243 @@
+#include "TerminalRenderer.h"
+
+
+// SGR codes for each combination of display plane bits
+static const int FG_CODES[4] = {39, 37, 36, 33};
+static const int BG_CODES[4] = {49, 47, 46, 43};
+
+// Passed to append_colours for a colour the glyph doesn't show
+static const int COLOUR_ANY = -1;
+
+// Braille dot bits by [row][column] within a 2x4 cell
+static const uint8_t BRAILLE_DOTS[4][2] = {
+	{0x01, 0x08},
+	{0x02, 0x10},
+	{0x04, 0x20},
+	{0x40, 0x80}
+};
+
+static void append_utf8(std::string &out, uint16_t code_point){
+	out += (char) (0xE0 | (code_point >> 12));
+	out += (char) (0x80 | ((code_point >> 6) & 0x3F));
+	out += (char) (0x80 | (code_point & 0x3F));
+}
+
+
+TerminalRenderer::TerminalRenderer(TerminalCellMode mode, double max_fps, double bytes_per_second){
+	this->mode = mode;
+	this->min_frame_interval = max_fps > 0 ? 1.0 / max_fps : 0;
+	this->bytes_per_second = bytes_per_second;
+
+	columns = 0;
+	rows = 0;
+	have_time = false;
+	last_render_time = 0;
+	last_budget_time = 0;
+	budget = 0;
+	frames_rendered = 0;
+	frames_dropped = 0;
+	bytes_sent = 0;
+	sent_display_hash = 0;
+	invalidate();
+}
+
+void TerminalRenderer::invalidate(){
+	full_redraw = true;
+	cursor_x = -1;
+	cursor_y = -1;
+	fg = -1;
+	bg = -1;
+}
+
+
+// Half block cells hold the top pixel in bits 0-1 and the bottom one in
+// bits 2-3. Braille cells hold the dots in bits 0-7 and the OR of the
+// pixels in bits 8-9.
+uint16_t TerminalRenderer::get_cell(Chip8 *chip8, int column, int row){
+	if (mode == TERMINAL_HALF_BLOCK){
+		return chip8->get_display_pixel(column, row*2) | chip8->get_display_pixel(column, row*2+1) << 2;
+	}
+
+	uint16_t dots = 0;
+	uint16_t colour = 0;
+	for (int dy = 0; dy < 4; ++dy){
+		for (int dx = 0; dx < 2; ++dx){
+			uint8_t pixel = chip8->get_display_pixel(column*2+dx, row*4+dy);
+			if (pixel){
+				dots |= BRAILLE_DOTS[dy][dx];
+				colour |= pixel;
+			}
+		}
+	}
+	return dots | colour << 8;
+}
+
+void TerminalRenderer::append_colours(std::string &out, int new_fg, int new_bg){
+	std::string codes;
+	if (new_fg != COLOUR_ANY && new_fg != fg){
+		codes += std::to_string(FG_CODES[new_fg]);
+		fg = new_fg;
+	}
+	if (new_bg != COLOUR_ANY && new_bg != bg){
+		if (!codes.empty()){
+			codes += ';';
+		}
+		codes += std::to_string(BG_CODES[new_bg]);
+		bg = new_bg;
+	}
+	if (!codes.empty()){
+		out += "\x1b[" + codes + "m";
+	}
+}
+
+void TerminalRenderer::append_cell(std::string &out, uint16_t cell){
+	if (mode == TERMINAL_HALF_BLOCK){
+		int top = cell & 0x3;
+		int bottom = cell >> 2;
+		if (top == bottom && top == 0){
+			append_colours(out, COLOUR_ANY, 0);
+			out += ' ';
+		} else if (top == bottom){
+			append_colours(out, top, COLOUR_ANY);
+			append_utf8(out, 0x2588);
+		} else if (top == 0){
+			append_colours(out, bottom, 0);
+			append_utf8(out, 0x2584);
+		} else {
+			append_colours(out, top, bottom);
+			append_utf8(out, 0x2580);
+		}
+	} else {
+		if ((cell & 0xFF) == 0){
+			append_colours(out, COLOUR_ANY, 0);
+			out += ' ';
+		} else {
+			append_colours(out, cell >> 8, 0);
+			append_utf8(out, 0x2800 + (cell & 0xFF));
+		}
+	}
+
+	// Writing the last column leaves the cursor in a terminal-dependent place
+	cursor_x++;
+	if (cursor_x >= columns){
+		cursor_x = -1;
+		cursor_y = -1;
+	}
+}
+
+void TerminalRenderer::append_move(std::string &out, int column, int row){
+	out += "\x1b[" + std::to_string(row+1) + ";" + std::to_string(column+1) + "H";
+	cursor_x = column;
+	cursor_y = row;
+}
+
+
+bool TerminalRenderer::render(Chip8 *chip8, double now, std::string &out){
+	int new_columns = chip8->get_display_width();
+	int new_rows = chip8->get_display_height() / 2;
+	if (mode == TERMINAL_BRAILLE){
+		new_columns /= 2;
+		new_rows = chip8->get_display_height() / 4;
+	}
+	if (new_columns != columns || new_rows != rows){
+		columns = new_columns;
+		rows = new_rows;
+		cells.assign(columns*rows, 0);
+		invalidate();
+	}
+
+	// Refill the byte budget, allowing at most a second's worth of burst
+	if (have_time && bytes_per_second > 0){
+		budget += (now - last_budget_time) * bytes_per_second;
+		if (budget > bytes_per_second){
+			budget = bytes_per_second;
+		}
+	}
+	last_budget_time = now;
+
+	if (!full_redraw && chip8->get_display_hash() == sent_display_hash){
+		return false;
+	}
+	if (have_time && now - last_render_time < min_frame_interval){
+		frames_dropped++;
+		return false;
+	}
+	if (have_time && bytes_per_second > 0 && budget < 0){
+		frames_dropped++;
+		return false;
+	}
+
+	size_t start = out.size();
+	if (full_redraw){
+		out += "\x1b[0m\x1b[2J";
+	}
+
+	for (int row = 0; row < rows; ++row){
+		for (int column = 0; column < columns; ++column){
+			uint16_t cell = get_cell(chip8, column, row);
+			uint16_t &sent = cells[row*columns + column];
+			if (!full_redraw && cell == sent){
+				continue;
+			}
+
+			if (cursor_y != row || cursor_x != column){
+				// Rewriting a short run of unchanged cells can be cheaper
+				// than moving over them
+				int saved_fg = fg;
+				int saved_bg = bg;
+				std::string gap;
+				if (cursor_y == row && cursor_x >= 0 && cursor_x < column){
+					for (int x = cursor_x; x < column; ++x){
+						append_cell(gap, cells[row*columns + x]);
+					}
+				}
+				std::string move;
+				append_move(move, column, row);
+				if (!gap.empty() && gap.size() < move.size()){
+					out += gap;
+				} else {
+					fg = saved_fg;
+					bg = saved_bg;
+					out += move;
+				}
+			}
+
+			append_cell(out, cell);
+			sent = cell;
+		}
+	}
+
+	full_redraw = false;
+	sent_display_hash = chip8->get_display_hash();
+	have_time = true;
+	last_render_time = now;
+	budget -= out.size() - start;
+	frames_rendered++;
+	bytes_sent += out.size() - start;
+	return true;
+}
+
+
+std::string TerminalRenderer::get_enter_sequence(){
+	return "\x1b[?25l\x1b[2J";
+}
+
+std::string TerminalRenderer::get_exit_sequence(){
+	return "\x1b[0m\x1b[" + std::to_string(rows+1) + ";1H\x1b[?25h";
+}
+
+int TerminalRenderer::get_columns(){
+	return columns;
+}
+int TerminalRenderer::get_rows(){
+	return rows;
+}
+uint64_t TerminalRenderer::get_frames_rendered(){
+	return frames_rendered;
+}
+uint64_t TerminalRenderer::get_frames_dropped(){
+	return frames_dropped;
+}
+uint64_t TerminalRenderer::get_bytes_sent(){
+	return bytes_sent;
+}
@@ -0,0 +1,73 @@
+#ifndef TERMINAL_RENDERER_H
+#define TERMINAL_RENDERER_H
+
+#include "Chip8.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// How display pixels map onto character cells
+enum TerminalCellMode{
+	TERMINAL_HALF_BLOCK,		// 1x2 pixels per cell, upper/lower half blocks
+	TERMINAL_BRAILLE			// 2x4 pixels per cell, braille dots
+};
+
+// Renders the Chip8 display as ANSI text for a terminal. Each render only
+// emits the cells that changed since the last one sent, plus the cursor
+// moves and colour changes needed to reach them. Frames are dropped,
+// never queued, when they would exceed the frame rate or byte budget, so
+// a slow terminal costs detail rather than emulation speed.
+class TerminalRenderer{
+private:
+	TerminalCellMode mode;
+	double min_frame_interval;		// Seconds between renders, 0 for no limit
+	double bytes_per_second;		// Output budget, 0 for no limit
+
+	int columns;					// Cell grid of the last render, 0 before the first
+	int rows;
+	std::vector<uint16_t> cells;	// Cells as last sent to the terminal
+	bool full_redraw;
+	int cursor_x;					// Where the terminal cursor is, -1 if unknown
+	int cursor_y;
+	int fg;							// Current SGR colours, -1 if unknown
+	int bg;
+	uint64_t sent_display_hash;		// Display hash of the last render
+
+	bool have_time;
+	double last_render_time;
+	double last_budget_time;
+	double budget;					// Bytes we may still send, may go negative
+
+	uint64_t frames_rendered;
+	uint64_t frames_dropped;
+	uint64_t bytes_sent;
+
+	uint16_t get_cell(Chip8 *chip8, int column, int row);
+	void append_cell(std::string &out, uint16_t cell);
+	void append_move(std::string &out, int column, int row);
+	void append_colours(std::string &out, int new_fg, int new_bg);
+
+public:
+	TerminalRenderer(TerminalCellMode mode = TERMINAL_HALF_BLOCK, double max_fps = 30, double bytes_per_second = 0);
+
+	// Appends the escape sequences to bring the terminal up to date with
+	// chip8's display to out. now is in seconds on any monotonic clock.
+	// Returns false if nothing was emitted, because the display is
+	// unchanged or the frame was rate limited.
+	bool render(Chip8 *chip8, double now, std::string &out);
+
+	// Forget what the terminal shows, e.g. after it was resized or cleared
+	void invalidate();
+
+	// Sequences to set up and restore the terminal around rendering
+	std::string get_enter_sequence();
+	std::string get_exit_sequence();
+
+	int get_columns();
+	int get_rows();
+	uint64_t get_frames_rendered();
+	uint64_t get_frames_dropped();
+	uint64_t get_bytes_sent();
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "TileAtlas.h"
+#include <algorithm>
+#include <cmath>
+
+
+TileAtlas::TileAtlas(int tile_count, int tile_width, int tile_height){
+	this->tile_count = tile_count > 0 ? tile_count : 1;
+	this->tile_width = tile_width;
+	this->tile_height = tile_height;
+
+	// As square as possible in pixels, so it scales well into a window
+	columns = (int) std::ceil(std::sqrt((double) this->tile_count * tile_height / tile_width));
+	if (columns < 1){
+		columns = 1;
+	}
+	rows = (this->tile_count + columns - 1) / columns;
+
+	// Same colours as the SDL frontend
+	palette[0] = 0xFF000000;
+	palette[1] = 0xFF00FF00;
+	palette[2] = 0xFF0080FF;
+	palette[3] = 0xFFFFFFFF;
+
+	tile_hashes.assign(this->tile_count, 0);
+	tile_modes.assign(this->tile_count, 0);
+}
+
+
+int TileAtlas::get_tile_count(){
+	return tile_count;
+}
+int TileAtlas::get_tile_width(){
+	return tile_width;
+}
+int TileAtlas::get_tile_height(){
+	return tile_height;
+}
+int TileAtlas::get_columns(){
+	return columns;
+}
+int TileAtlas::get_rows(){
+	return rows;
+}
+int TileAtlas::get_width(){
+	return columns * tile_width;
+}
+int TileAtlas::get_height(){
+	return rows * tile_height;
+}
+
+int TileAtlas::get_tile_x(int index){
+	return (index % columns) * tile_width;
+}
+int TileAtlas::get_tile_y(int index){
+	return (index / columns) * tile_height;
+}
+
+void TileAtlas::set_palette(const uint32_t colours[4]){
+	for (int i = 0; i < 4; ++i){
+		palette[i] = colours[i];
+	}
+	invalidate();
+}
+
+
+bool TileAtlas::is_dirty(int index, Chip8 *chip8){
+	// The same bits mean a different picture at the other resolution
+	return tile_modes[index] != 1 + chip8->get_hires() || tile_hashes[index] != chip8->get_display_hash();
+}
+
+void TileAtlas::write_tile(int index, Chip8 *chip8, uint32_t *pixels, int pitch){
+	int width = chip8->get_display_width();
+	int height = chip8->get_display_height();
+	int scale_x = tile_width / width;
+	int scale_y = tile_height / height;
+
+	for (int y = 0; y < height; ++y){
+		const uint64_t *plane0 = chip8->get_display_row(0, y);
+		const uint64_t *plane1 = chip8->get_display_row(1, y);
+		uint32_t *out = (uint32_t*) ((uint8_t*) pixels + y*scale_y*pitch);
+
+		for (int word = 0; word < width/64; ++word){
+			uint64_t bits0 = plane0[word];
+			uint64_t bits1 = plane1[word];
+			for (int bit = 63; bit >= 0; --bit){
+				uint32_t colour = palette[((bits0 >> bit) & 1) | ((bits1 >> bit) & 1) << 1];
+				for (int k = 0; k < scale_x; ++k){
+					*out++ = colour;
+				}
+			}
+		}
+
+		// Repeat the row for vertical scaling
+		for (int k = 1; k < scale_y; ++k){
+			uint32_t *first = (uint32_t*) ((uint8_t*) pixels + y*scale_y*pitch);
+			uint32_t *copy = (uint32_t*) ((uint8_t*) pixels + (y*scale_y + k)*pitch);
+			std::copy(first, first + tile_width, copy);
+		}
+	}
+
+	tile_hashes[index] = chip8->get_display_hash();
+	tile_modes[index] = 1 + chip8->get_hires();
+}
+
+void TileAtlas::invalidate(){
+	std::fill(tile_modes.begin(), tile_modes.end(), 0);
+}
@@ -0,0 +1,52 @@
+#ifndef TILE_ATLAS_H
+#define TILE_ATLAS_H
+
+#include "Chip8.h"
+#include <stdint.h>
+#include <vector>
+
+// Packs the displays of many machines into one ARGB8888 image, one tile
+// each in a near-square grid, so a whole batch can be drawn from a single
+// texture. Tracks what each tile last showed so only changed displays
+// need converting and uploading.
+class TileAtlas{
+private:
+	int tile_count;
+	int tile_width;					// Pixels per tile. Smaller displays are scaled up
+	int tile_height;
+	int columns;					// Tiles per atlas row
+	int rows;
+	uint32_t palette[4];			// ARGB colour for each combination of plane bits
+
+	std::vector<uint64_t> tile_hashes;	// Display hash each tile was last written with
+	std::vector<uint8_t> tile_modes;	// 0 if never written, else 1 + hires
+
+public:
+	TileAtlas(int tile_count, int tile_width, int tile_height);
+
+	int get_tile_count();
+	int get_tile_width();
+	int get_tile_height();
+	int get_columns();
+	int get_rows();
+	int get_width();
+	int get_height();
+
+	// Top left corner of a tile in the atlas
+	int get_tile_x(int index);
+	int get_tile_y(int index);
+
+	void set_palette(const uint32_t colours[4]);
+
+	// True if chip8's display differs from what tile index last showed
+	bool is_dirty(int index, Chip8 *chip8);
+
+	// Converts chip8's display into a tile's pixels, pitch bytes per row,
+	// and records it as what the tile now shows
+	void write_tile(int index, Chip8 *chip8, uint32_t *pixels, int pitch);
+
+	// Forget every tile, e.g. after the texture was recreated
+	void invalidate();
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "SDL2/SDL.h"
 #include "Chip8.h"
+#include "LatencyTracker.h"
+#include "RomLoader.h"
 #include <stdio.h>
 #include <iostream>
 #include <string>
@@ -13,6 +15,48 @@
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+// Chip8 timing
+const int OPS_PER_FRAME = 10;
+const Uint32 FRAME_MS = 1000 / 60;
+
+// Chip8 hex keypad on the left of a QWERTY keyboard
+//   1 2 3 C      1 2 3 4
+//   4 5 6 D      Q W E R
+//   7 8 9 E      A S D F
+//   A 0 B F      Z X C V
+int get_chip8_key(SDL_Keycode sym){
+	switch (sym){
+		case SDLK_1: return 0x1;
+		case SDLK_2: return 0x2;
+		case SDLK_3: return 0x3;
+		case SDLK_4: return 0xC;
+		case SDLK_q: return 0x4;
+		case SDLK_w: return 0x5;
+		case SDLK_e: return 0x6;
+		case SDLK_r: return 0xD;
+		case SDLK_a: return 0x7;
+		case SDLK_s: return 0x8;
+		case SDLK_d: return 0x9;
+		case SDLK_f: return 0xE;
+		case SDLK_z: return 0xA;
+		case SDLK_x: return 0x0;
+		case SDLK_c: return 0xB;
+		case SDLK_v: return 0xF;
+		default:     return -1;
+	}
+}
+
+// High resolution time in seconds for latency tracking
+double get_seconds(){
+	return (double) SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency();
+}
+
+// An event's timestamp, in SDL_GetTicks milliseconds, on the get_seconds clock
+double get_event_seconds(Uint32 timestamp){
+	Uint32 age = SDL_GetTicks() - timestamp;
+	return get_seconds() - age / 1000.0;
+}
+
 void load_file_to_memory(Chip8 *chip8, std::string rom_file, uint16_t memory_offset){
 	std::ifstream is (rom_file, std::ifstream::binary);
 
@@ -45,7 +89,7 @@ void load_file_to_memory(Chip8 *chip8, std::string rom_file, uint16_t memory_off
 void print_ram(Chip8 *chip8){
 	int per_row = 32;
 	
-	for (int i = 0; i < 4096/per_row; ++i){
+	for (int i = 0; i < (int) chip8->get_memory_size()/per_row; ++i){
 
 		if (i*per_row < 10){
 			std::cout << "   ";
@@ -95,6 +139,16 @@ void set_pixel32( SDL_Surface *surface, int x, int y, Uint32 pixel ){
 }
 
 
+// Colours for each combination of display plane bits
+Uint32 get_plane_colour(SDL_PixelFormat *fmt, uint8_t planes){
+	switch (planes){
+		case 1:  return SDL_MapRGBA(fmt, 0, 255, 0, 1);
+		case 2:  return SDL_MapRGBA(fmt, 0, 128, 255, 1);
+		case 3:  return SDL_MapRGBA(fmt, 255, 255, 255, 1);
+		default: return SDL_MapRGBA(fmt, 0, 0, 0, 1);
+	}
+}
+
 void draw_chip8_display(SDL_Surface *surface, Chip8 *chip8){
 	SDL_PixelFormat *fmt;
 	fmt = surface->format;
@@ -104,16 +158,10 @@ void draw_chip8_display(SDL_Surface *surface, Chip8 *chip8){
     }
 
 
-    uint8_t *display = chip8->get_display();
-    int display_size = chip8->get_display_width() * chip8->get_display_height();
-
-    for (int i = 0; i < display_size; ++i){
-	Uint32 pix = SDL_MapRGBA(fmt, 0, 255*(int)display[i], 0, 1);
-    	set_pixel32(surface, 
-    		i%chip8->get_display_width(),
-    		i/chip8->get_display_width(),
-    		pix);
-
+    for (int y = 0; y < chip8->get_display_height(); ++y){
+    	for (int x = 0; x < chip8->get_display_width(); ++x){
+    		set_pixel32(surface, x, y, get_plane_colour(fmt, chip8->get_display_pixel(x, y)));
+    	}
     }
 
 
@@ -132,23 +180,23 @@ void draw_chip8_display(SDL_Surface *surface, Chip8 *chip8, int display_ratio){
     }
 
 
-    uint8_t *display = chip8->get_display();
-    int display_size = chip8->get_display_width() * chip8->get_display_height();
-
-    for (int i = 0; i < display_size; ++i){
-		Uint32 pix = SDL_MapRGBA(fmt, 0, 255*(bool)display[i], 0, 1);
+    // The surface is sized for 64x32 at display_ratio, so 128x64 XO-CHIP
+    // hires pixels are drawn at half the size
+    int scale = display_ratio * 64 / chip8->get_display_width();
 
-		int pix_x = i%chip8->get_display_width()*display_ratio;
-		int pix_y = i/chip8->get_display_width()*display_ratio;
+    for (int y = 0; y < chip8->get_display_height(); ++y){
+    	for (int x = 0; x < chip8->get_display_width(); ++x){
+			Uint32 pix = get_plane_colour(fmt, chip8->get_display_pixel(x, y));
 
-		for (int j = 0; j < display_ratio; ++j){
-			for (int k = 0; k < display_ratio; ++k){
-				set_pixel32(surface, 
-		    		pix_x+j,
-		    		pix_y+k,
-		    		pix);
+			for (int j = 0; j < scale; ++j){
+				for (int k = 0; k < scale; ++k){
+					set_pixel32(surface,
+			    		x*scale+j,
+			    		y*scale+k,
+			    		pix);
+				}
 			}
-		}
+    	}
     }
 
 
@@ -158,6 +206,14 @@ void draw_chip8_display(SDL_Surface *surface, Chip8 *chip8, int display_ratio){
 
 }
 
+// Print the errors of ROMs the loader dropped since the last call
+void report_load_errors(RomLoader *loader){
+	std::vector<std::string> errors = loader->take_errors();
+	for (size_t i = 0; i < errors.size(); ++i){
+		std::cerr << errors[i] << std::endl;
+	}
+}
+
 void draw_all_sprites(Chip8 *chip8){
 	for (int i = 0; i < 16; ++i){
 		uint8_t x = 8*i;
@@ -174,8 +230,28 @@ int main(int argc, char* args[]){
 	//The surface contained by the window
 	SDL_Surface* screenSurface = NULL;
 
+	// Queue up the ROMs to play. They are read and validated on a
+	// background thread and cycle forever, kiosk style.
+	// --xochip selects the XO-CHIP machine, --trace prints every op.
+	Chip8Machine machine = MACHINE_CHIP8;
+	uint8_t debug = 0;
+	std::vector<std::string> rom_files;
+	for (int i = 1; i < argc; ++i){
+		if (std::string(args[i]) == "--xochip"){
+			machine = MACHINE_XOCHIP;
+		} else if (std::string(args[i]) == "--trace"){
+			debug |= DEBUG_TRACE;
+		} else {
+			rom_files.push_back(args[i]);
+		}
+	}
+	if (rom_files.empty()){
+		rom_files.push_back("../roms/programs/IBM Logo.ch8");
+	}
+
 	// Chip8 stuff
-	Chip8 chip8;
+	Chip8 chip8(machine);
+	chip8.set_debug(debug);
 	chip8.fill_display(0);
 	int display_ratio = 4;
 	SDL_Rect chip8_location{200, 200, chip8.get_display_width()*display_ratio, chip8.get_display_height()*display_ratio};
@@ -184,8 +260,21 @@ int main(int argc, char* args[]){
 	load_file_to_memory(&chip8, "../src/sprites.txt", 0x0000);
 	// draw_all_sprites(&chip8);
 
-	// Load ROM
-	load_file_to_memory(&chip8, "../roms/programs/IBM Logo.ch8", 0x0200);
+	RomLoader loader(2, chip8.get_memory_size() - 0x200);
+	for (size_t i = 0; i < rom_files.size(); ++i){
+		loader.enqueue(rom_files[i]);
+	}
+
+	// Load the first ROM
+	Rom rom;
+	if (!loader.wait_next(rom)){
+		report_load_errors(&loader);
+		return 1;
+	}
+	report_load_errors(&loader);
+	chip8.load_rom(rom.data.data(), (uint16_t) rom.data.size());
+	loader.enqueue(rom.path);
+	bool swap_requested = false;
 
 	// print_ram(&chip8);
 
@@ -213,14 +302,60 @@ int main(int argc, char* args[]){
 	//Get window surface
 	screenSurface = SDL_GetWindowSurface(window);
 
+	// Follows key presses through to the screen
+	LatencyTracker latency(FRAME_MS / 1000.0);
+
 	int run = 1;
 	while(run){
+		Uint32 frame_start = SDL_GetTicks();
+
+		SDL_Event event;
+		while (SDL_PollEvent(&event)){
+			if (event.type == SDL_QUIT){
+				run = 0;
+			}
+			// Tab switches to the next ROM
+			else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB){
+				swap_requested = true;
+			}
+			// Keys go straight to the keypad, ready for the next frame
+			else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && !event.key.repeat){
+				int key = get_chip8_key(event.key.keysym.sym);
+				if (key >= 0 && event.type == SDL_KEYDOWN){
+					latency.key_received(get_event_seconds(event.key.timestamp));
+					chip8.set_key(key, 1);
+					latency.key_applied(&chip8, get_seconds());
+				} else if (key >= 0){
+					chip8.set_key(key, 0);
+				}
+			}
+		}
+
+		// Swap ROMs between frames. The next one was already prefetched,
+		// so this is a memory copy and the window and surfaces stay.
+		// ROMs that failed to load on the way are reported and skipped.
+		if (swap_requested){
+			if (loader.take_next(rom)){
+				chip8.load_rom(rom.data.data(), (uint16_t) rom.data.size());
+				loader.enqueue(rom.path);
+				swap_requested = false;
+			}
+			report_load_errors(&loader);
+		}
 
 		//Fill the surface black
 		SDL_FillRect(screenSurface, NULL, SDL_MapRGB(screenSurface->format, 0x30, 0x30, 0x30));
 		SDL_FillRect(gameDisplaySurface, NULL, SDL_MapRGB(gameDisplaySurface->format, 0x00, 0x00, 0x00));
 
-		run = chip8.execute_next_op();
+		// When a ROM ends, move on to the next one if there is one
+		latency.frame_started(&chip8, get_seconds());
+		if (!chip8.run_frame(OPS_PER_FRAME)){
+			swap_requested = true;
+			if (rom_files.size() == 1){
+				run = 0;
+			}
+		}
+		latency.frame_emulated(&chip8, get_seconds());
 
 		// Draw the Chip8 screen
         draw_chip8_display(gameDisplaySurface, &chip8, display_ratio);
@@ -228,11 +363,20 @@ int main(int argc, char* args[]){
 
 		//Update the surface
 		SDL_UpdateWindowSurface(window);
+		latency.frame_presented(get_seconds());
 
-		//Wait two seconds
-		// SDL_Delay(1000);
+		// Sleep off the rest of the frame. Idle loops are fast-forwarded
+		// by run_frame, so this is most of the frame for most ROMs.
+		Uint32 frame_time = SDL_GetTicks() - frame_start;
+		if (frame_time < FRAME_MS){
+			SDL_Delay(FRAME_MS - frame_time);
+		}
 	}
 
+	std::cout << "Executed " << std::dec << chip8.get_executed_op_count()
+		<< " ops, skipped " << chip8.get_skipped_op_count() << " idle ops" << std::endl;
+	latency.write_report(std::cout);
+
 	//Destroy window
 	SDL_DestroyWindow(window);
 
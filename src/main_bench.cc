@@ -0,0 +1,197 @@
+#include "Chip8.h"
+#include "Chip8Debugger.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+// Best of a few runs, to keep scheduling noise out
+const int RUNS = 5;
+
+// V0 += 1; V1 += V0; I = 0x300; store V0-V1; load V0-V1; SE V0, 0; loop.
+// Both sides of the skip jump back, so it never halts.
+uint8_t alu_rom[] = {
+	0x70, 0x01, 0x81, 0x04, 0xA3, 0x00, 0xF1, 0x55,
+	0xF1, 0x65, 0x30, 0x00, 0x12, 0x00, 0x12, 0x00
+};
+
+// Draw a 15 row sprite at (V0, 0), V0 += step, wrapping at 64, loop.
+// A step of 8 puts it at 8 columns, 8 px apart; 0 keeps x fixed.
+uint8_t sprite_rom[] = {
+	0xA2, 0x20, 0x60, 0x00, 0x61, 0x00, 0xD0, 0x1F,
+	0x70, 0x08, 0x30, 0x40, 0x12, 0x06, 0x12, 0x02,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0x3C, 0x42, 0x81, 0xA5, 0x81, 0x99, 0x42, 0x3C,
+	0x18, 0x3C, 0x7E, 0xFF, 0x7E, 0x3C, 0x18
+};
+const int SPRITE_STEP = 9;
+
+double get_seconds(){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU time of this thread, which time spent descheduled doesn't add to
+double get_cpu_seconds(){
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void report(const std::string &name, double seconds, uint64_t count, const std::string &unit){
+	std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(10) << seconds / count * 1e9 << " ns/" << unit << std::endl;
+}
+
+Chip8 make_machine(Chip8Machine machine, const uint8_t *rom, uint16_t length){
+	Chip8 chip8(machine);
+	chip8.set_idle_skip(false);
+	chip8.load_rom(rom, length);
+	return chip8;
+}
+
+// Ops executed back to back through execute_next_op
+double bench_ops(Chip8Machine machine, uint64_t ops){
+	double best = 1e9;
+	for (int run = 0; run < RUNS; ++run){
+		Chip8 chip8 = make_machine(machine, alu_rom, sizeof(alu_rom));
+		double start = get_seconds();
+		for (uint64_t i = 0; i < ops; ++i){
+			chip8.execute_next_op();
+		}
+		best = std::min(best, get_seconds() - start);
+	}
+	return best;
+}
+
+// Frames of ops_per_frame ops and a timer tick, as run_frame runs them
+// with idle skipping off, and the same ops through an unarmed debugger,
+// which also keeps snapshots. Both machines run on in many short slices
+// whose order alternates, timed in thread CPU time, so a slow patch of the
+// host lands on both sides. Returns the median of the per slice ratios;
+// the totals include the slices that took a snapshot.
+double bench_debugger(Chip8Machine machine, uint64_t ops, int ops_per_frame, double *plain, double *debugged){
+	const int SLICES = 400;
+	uint64_t slice_frames = ops / SLICES / ops_per_frame;
+
+	Chip8 chip8 = make_machine(machine, alu_rom, sizeof(alu_rom));
+	Chip8 traced = make_machine(machine, alu_rom, sizeof(alu_rom));
+	Chip8Debugger debugger(&traced, ops_per_frame);
+
+	std::vector<double> ratios;
+	*plain = 0;
+	*debugged = 0;
+	for (int slice = 0; slice < SLICES; ++slice){
+		double plain_seconds = 0, debugged_seconds = 0;
+		for (int side = 0; side < 2; ++side){
+			double start = get_cpu_seconds();
+			if ((side + slice) % 2 == 0){
+				for (uint64_t i = 0; i < slice_frames; ++i){
+					chip8.execute_ops(ops_per_frame);
+					chip8.tick_timers();
+				}
+				plain_seconds = get_cpu_seconds() - start;
+			}
+			else{
+				debugger.run(slice_frames * ops_per_frame);
+				debugged_seconds = get_cpu_seconds() - start;
+			}
+		}
+		*plain += plain_seconds;
+		*debugged += debugged_seconds;
+		ratios.push_back(debugged_seconds / plain_seconds);
+	}
+
+	std::sort(ratios.begin(), ratios.end());
+	return ratios[SLICES / 2];
+}
+
+// CHIP-8 DRW without and with the sprite row cache, alternating run by
+// run. Returns the cache's hits per DRW; every DRW changes the display.
+double bench_sprites(uint8_t step, uint64_t ops, double *uncached, double *cached){
+	*uncached = 1e9;
+	*cached = 1e9;
+	double hit_rate = 0;
+	sprite_rom[SPRITE_STEP] = step;
+	for (int run = 0; run < RUNS * 4; ++run){
+		for (int cache = 0; cache < 2; ++cache){
+			Chip8 chip8 = make_machine(MACHINE_CHIP8, sprite_rom, sizeof(sprite_rom));
+			chip8.set_sprite_cache(cache);
+			double start = get_seconds();
+			for (uint64_t i = 0; i < ops; ++i){
+				chip8.execute_next_op();
+			}
+			double seconds = get_seconds() - start;
+			if (cache){
+				*cached = std::min(*cached, seconds);
+				hit_rate = (double) chip8.get_sprite_cache_hit_count() / chip8.get_display_change_count();
+			}
+			else{
+				*uncached = std::min(*uncached, seconds);
+			}
+		}
+	}
+	return hit_rate;
+}
+
+void report_overhead(const std::string &name, double base, double seconds){
+	std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2)
+		<< std::setw(10) << (seconds / base - 1) * 100 << " %" << std::endl;
+}
+
+// Copy-assigning a machine, as env resets and debugger snapshots do
+double bench_copy(Chip8Machine machine, uint64_t copies){
+	double best = 1e9;
+	Chip8 source = make_machine(machine, alu_rom, sizeof(alu_rom));
+	Chip8 target(machine);
+	for (int run = 0; run < RUNS; ++run){
+		double start = get_seconds();
+		for (uint64_t i = 0; i < copies; ++i){
+			target = source;
+			source.set_V(0, (uint8_t) i);
+		}
+		best = std::min(best, get_seconds() - start);
+	}
+	return best + (target.get_V(0) & 0) * 1e-12;
+}
+
+// Micro benchmarks for the hot paths of the core. Each prints a time per
+// op or per operation so changes can be compared before and after.
+int main(int argc, char* args[]){
+	uint64_t ops = 20000000;
+	if (argc > 1){
+		ops = std::stoull(args[1]);
+	}
+
+	report("execute_next_op, CHIP-8", bench_ops(MACHINE_CHIP8, ops), ops, "op");
+	report("execute_next_op, XO-CHIP", bench_ops(MACHINE_XOCHIP, ops), ops, "op");
+	report("copy, CHIP-8", bench_copy(MACHINE_CHIP8, ops / 100), ops / 100, "copy");
+	report("copy, XO-CHIP", bench_copy(MACHINE_XOCHIP, ops / 100), ops / 100, "copy");
+
+	// About one op in four is a DRW
+	for (uint8_t step : {8, 0}){
+		std::string suffix = step ? ", 8 columns" : ", fixed x";
+		double uncached, cached;
+		double hit_rate = bench_sprites(step, ops / 4, &uncached, &cached);
+		report("DRW loop, cache off" + suffix, uncached, ops / 4, "op");
+		report("DRW loop, cache on" + suffix, cached, ops / 4, "op");
+		report_overhead("cache speedup" + suffix, cached, uncached);
+		std::cout << std::left << std::setw(40) << "cache hits per DRW" + suffix << std::right
+			<< std::setw(10) << hit_rate << std::endl;
+	}
+
+	for (Chip8Machine machine : {MACHINE_CHIP8, MACHINE_XOCHIP}){
+		std::string suffix = machine == MACHINE_CHIP8 ? ", CHIP-8" : ", XO-CHIP";
+		double base, debugged;
+		double ratio = bench_debugger(machine, ops, 10, &base, &debugged);
+		report("plain frames" + suffix, base, ops, "op");
+		report("unarmed debugger" + suffix, debugged, ops, "op");
+		report_overhead("debugger overhead" + suffix, base, debugged);
+		report_overhead("debugger overhead, median slice" + suffix, 1, ratio);
+	}
+
+	return 0;
+}
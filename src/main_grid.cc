@@ -0,0 +1,153 @@
+#include "SDL2/SDL.h"
+#include "Chip8.h"
+#include "RomLoader.h"
+#include "TileAtlas.h"
+#include <algorithm>
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+const int WINDOW_MAX_WIDTH = 1920;
+const int WINDOW_MAX_HEIGHT = 1080;
+
+// Chip8 timing
+const int OPS_PER_FRAME = 10;
+const Uint32 FRAME_MS = 1000 / 60;
+
+// Runs a batch of machines and tiles all their displays into one window.
+// The displays live in a single streaming texture: each frame only the
+// tiles whose display hash changed are converted and uploaded, then the
+// whole atlas is drawn with one copy and one present.
+//   --xochip       XO-CHIP machines
+//   --count N      number of machines (default 256), ROMs are dealt out in turn
+int main(int argc, char* args[]){
+	Chip8Machine machine = MACHINE_CHIP8;
+	int count = 256;
+	std::vector<std::string> rom_files;
+	for (int i = 1; i < argc; ++i){
+		std::string arg = args[i];
+		if (arg == "--xochip"){
+			machine = MACHINE_XOCHIP;
+		} else if (arg == "--count" && i+1 < argc){
+			count = std::stoi(args[++i]);
+		} else {
+			rom_files.push_back(arg);
+		}
+	}
+	if (rom_files.empty() || count < 1){
+		std::cerr << "Usage: " << args[0] << " [--xochip] [--count N] <rom>..." << std::endl;
+		return 1;
+	}
+
+	// Every ROM is read once, up front
+	std::vector<Chip8> machines(count, Chip8(machine));
+	std::vector<std::vector<uint8_t> > roms(rom_files.size());
+	for (size_t i = 0; i < rom_files.size(); ++i){
+		std::string error;
+		if (!RomLoader::load_rom_file(rom_files[i], machines[0].get_memory_size() - 0x200, roms[i], error)){
+			std::cerr << rom_files[i] << ": " << error << std::endl;
+			return 1;
+		}
+	}
+	std::vector<bool> halted(count, false);
+	for (int i = 0; i < count; ++i){
+		const std::vector<uint8_t> &rom = roms[i % roms.size()];
+		machines[i].load_rom(rom.data(), (uint16_t) rom.size());
+	}
+
+	// Tiles are sized for the largest display the machine can show
+	TileAtlas atlas(count, machine == MACHINE_XOCHIP ? 128 : 64, machine == MACHINE_XOCHIP ? 64 : 32);
+
+	// Whole pixels per atlas pixel that still fit the window
+	int scale = std::min(WINDOW_MAX_WIDTH / atlas.get_width(), WINDOW_MAX_HEIGHT / atlas.get_height());
+	if (scale < 1){
+		scale = 1;
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO) < 0){
+		printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+		return 1;
+	}
+	SDL_Window *window = SDL_CreateWindow("Chip8 grid", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+		atlas.get_width()*scale, atlas.get_height()*scale, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+	if (window == NULL){
+		printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
+		return 1;
+	}
+	SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	if (renderer == NULL){
+		printf("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
+		return 1;
+	}
+	SDL_RenderSetLogicalSize(renderer, atlas.get_width(), atlas.get_height());
+
+	SDL_RendererInfo info;
+	SDL_GetRendererInfo(renderer, &info);
+	if (atlas.get_width() > info.max_texture_width || atlas.get_height() > info.max_texture_height){
+		printf("%d instances need a %dx%d texture, more than this renderer supports\n",
+			count, atlas.get_width(), atlas.get_height());
+		return 1;
+	}
+	SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+		atlas.get_width(), atlas.get_height());
+
+	uint64_t frames = 0;
+	uint64_t tiles_uploaded = 0;
+	int run = 1;
+	while (run){
+		Uint32 frame_start = SDL_GetTicks();
+
+		SDL_Event event;
+		while (SDL_PollEvent(&event)){
+			if (event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)){
+				run = 0;
+			}
+		}
+
+		for (int i = 0; i < count; ++i){
+			if (!halted[i] && !machines[i].run_frame(OPS_PER_FRAME)){
+				halted[i] = true;
+			}
+		}
+
+		// Locked texture memory is write-only, so each dirty tile is
+		// locked on its own and written in full
+		for (int i = 0; i < count; ++i){
+			if (!atlas.is_dirty(i, &machines[i])){
+				continue;
+			}
+			SDL_Rect rect{atlas.get_tile_x(i), atlas.get_tile_y(i), atlas.get_tile_width(), atlas.get_tile_height()};
+			void *pixels;
+			int pitch;
+			if (SDL_LockTexture(texture, &rect, &pixels, &pitch) == 0){
+				atlas.write_tile(i, &machines[i], (uint32_t*) pixels, pitch);
+				SDL_UnlockTexture(texture);
+				tiles_uploaded++;
+			}
+		}
+
+		SDL_SetRenderDrawColor(renderer, 0x30, 0x30, 0x30, 0xFF);
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+		frames++;
+
+		// Present waits for vsync where available, this covers the rest
+		Uint32 frame_time = SDL_GetTicks() - frame_start;
+		if (frame_time < FRAME_MS){
+			SDL_Delay(FRAME_MS - frame_time);
+		}
+	}
+
+	std::cout << "Ran " << count << " machines for " << frames << " frames, uploaded "
+		<< tiles_uploaded << " of " << frames * count << " tiles" << std::endl;
+
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+
+	return 0;
+}
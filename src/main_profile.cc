@@ -0,0 +1,54 @@
+#include "Chip8.h"
+#include "Chip8Profiler.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+const int OPS_PER_FRAME = 10;
+
+// Runs a ROM headless under the profiler and writes
+//   <out>.folded      ops per call path, for flamegraph.pl
+//   <out>.pixels      DRW pixels per call path
+//   <out>.asm         annotated disassembly
+int main(int argc, char* args[]){
+	if (argc < 4){
+		std::cerr << "Usage: " << args[0] << " <rom> <frames> <out>" << std::endl;
+		return 1;
+	}
+	std::string rom_file = args[1];
+	int frames = std::stoi(args[2]);
+	std::string out_file = args[3];
+
+	std::ifstream is(rom_file, std::ifstream::binary);
+	if (!is){
+		std::cerr << "Could not open " << rom_file << std::endl;
+		return 1;
+	}
+	std::vector<uint8_t> rom((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	if (rom.empty() || rom.size() > 4096 - 0x200){
+		std::cerr << "Bad ROM size " << rom.size() << std::endl;
+		return 1;
+	}
+
+	Chip8 chip8;
+	chip8.set_memory_block(0x200, rom.data(), (uint16_t) rom.size());
+
+	Chip8Profiler profiler(&chip8);
+	for (int i = 0; i < frames; ++i){
+		if (!profiler.run_frame(OPS_PER_FRAME)){
+			break;
+		}
+	}
+
+	std::ofstream folded(out_file + ".folded");
+	profiler.write_folded(folded, PROFILE_OPS);
+	std::ofstream pixels(out_file + ".pixels");
+	profiler.write_folded(pixels, PROFILE_PIXELS);
+	std::ofstream disassembly(out_file + ".asm");
+	profiler.write_annotated_disassembly(disassembly);
+
+	return 0;
+}
@@ -0,0 +1,134 @@
+#include "Chip8.h"
+#include "RomLoader.h"
+#include "TerminalRenderer.h"
+#include <chrono>
+#include <csignal>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+const int OPS_PER_FRAME = 10;
+const std::chrono::microseconds FRAME_TIME(1000000 / 60);
+
+static volatile std::sig_atomic_t running = 1;
+
+static void stop(int){
+	running = 0;
+}
+
+// Opens stdout again as a new open file description, so O_NONBLOCK can be
+// set on it alone. Setting it on stdout would change the terminal for the
+// shell and everything else sharing it, and stay set if we were killed.
+// Falls back to stdout itself, blocking, for files, sockets or no /proc.
+static int open_nonblocking_stdout(){
+	struct stat st;
+	if (fstat(STDOUT_FILENO, &st) == 0 && (S_ISCHR(st.st_mode) || S_ISFIFO(st.st_mode))){
+		int fd = open("/proc/self/fd/1", O_WRONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+		if (fd >= 0){
+			return fd;
+		}
+	}
+	return STDOUT_FILENO;
+}
+
+// Writes as much of pending to fd as it will take, without blocking if
+// fd is non-blocking
+static void flush_pending(int fd, std::string &pending){
+	while (!pending.empty()){
+		ssize_t written = write(fd, pending.data(), pending.size());
+		if (written <= 0){
+			return;
+		}
+		pending.erase(0, written);
+	}
+}
+
+// Runs a ROM headless and shows its display in the terminal, e.g. over SSH.
+//   --xochip       XO-CHIP machine
+//   --braille      2x4 pixels per character rather than 1x2
+//   --fps N        most terminal updates per second (default 30)
+//   --bps N        most bytes per second sent to the terminal (default no limit)
+int main(int argc, char* args[]){
+	Chip8Machine machine = MACHINE_CHIP8;
+	TerminalCellMode mode = TERMINAL_HALF_BLOCK;
+	double fps = 30;
+	double bps = 0;
+	std::string rom_file;
+	for (int i = 1; i < argc; ++i){
+		std::string arg = args[i];
+		if (arg == "--xochip"){
+			machine = MACHINE_XOCHIP;
+		} else if (arg == "--braille"){
+			mode = TERMINAL_BRAILLE;
+		} else if (arg == "--fps" && i+1 < argc){
+			fps = std::stod(args[++i]);
+		} else if (arg == "--bps" && i+1 < argc){
+			bps = std::stod(args[++i]);
+		} else {
+			rom_file = arg;
+		}
+	}
+	if (rom_file.empty()){
+		std::cerr << "Usage: " << args[0] << " [--xochip] [--braille] [--fps N] [--bps N] <rom>" << std::endl;
+		return 1;
+	}
+
+	Chip8 chip8(machine);
+
+	std::vector<uint8_t> rom;
+	std::string error;
+	if (!RomLoader::load_rom_file(rom_file, chip8.get_memory_size() - 0x200, rom, error)){
+		std::cerr << rom_file << ": " << error << std::endl;
+		return 1;
+	}
+	chip8.load_rom(rom.data(), (uint16_t) rom.size());
+
+	std::signal(SIGINT, stop);
+	std::signal(SIGTERM, stop);
+
+	// A slow terminal must never hold up emulation, so output is written
+	// non-blocking and no new frame is rendered until the last one is out
+	int out = open_nonblocking_stdout();
+
+	TerminalRenderer renderer(mode, fps, bps);
+	std::string pending = renderer.get_enter_sequence();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point next_frame = start;
+	while (running){
+		if (!chip8.run_frame(OPS_PER_FRAME)){
+			break;
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (pending.empty()){
+			renderer.render(&chip8, std::chrono::duration<double>(now - start).count(), pending);
+		}
+		flush_pending(out, pending);
+
+		next_frame += FRAME_TIME;
+		if (next_frame < now){
+			next_frame = now;
+		}
+		std::this_thread::sleep_until(next_frame);
+	}
+
+	// Let the final frame and the terminal restore through, blocking
+	if (out != STDOUT_FILENO){
+		close(out);
+	}
+	pending += renderer.get_exit_sequence();
+	flush_pending(STDOUT_FILENO, pending);
+
+	std::cout << "Executed " << chip8.get_executed_op_count()
+		<< " ops, skipped " << chip8.get_skipped_op_count() << " idle ops. Rendered "
+		<< renderer.get_frames_rendered() << " frames, dropped " << renderer.get_frames_dropped()
+		<< ", sent " << renderer.get_bytes_sent() << " bytes" << std::endl;
+
+	return 0;
+}
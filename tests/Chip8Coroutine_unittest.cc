@@ -0,0 +1,65 @@
+#include "../src/Chip8.h"
+#include "../src/Chip8Coroutine.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+
+TEST(chipScheduler, timerWaitEndsInRunFrameState){
+	// DT = 12; wait for DT == 2; V2 = AA; JP self
+	// Frame boundaries don't line up with run_frame's while the wait is
+	// on: the session parks at the loop and gets a whole frame of ops once
+	// woken, where run_frame spins part of an iteration. So only the state
+	// both settle in on JP self is compared, not the state frame by frame.
+	uint8_t rom[] = {
+		0x60, 0x0C, 0xF0, 0x15,
+		0xF1, 0x07, 0x31, 0x02, 0x12, 0x04,
+		0x62, 0xAA, 0x12, 0x0C
+	};
+	Chip8 a, b;
+	a.load_rom(rom, sizeof(rom));
+	b.load_rom(rom, sizeof(rom));
+
+	Chip8Scheduler scheduler(8);
+	scheduler.add(&b);
+	for (int f = 0; f < 20; ++f){
+		a.run_frame(8);
+		scheduler.run_frame();
+	}
+	scheduler.sync_timers(0);
+	EXPECT_EQ(b.get_V(2), 0xAA);
+	EXPECT_EQ(a.get_state_hash(), b.get_state_hash());
+
+	// Once at the start, once when the timer was due, then parked on JP
+	EXPECT_EQ(scheduler.get_resume_count(), 2u);
+	EXPECT_EQ(scheduler.get_wait_reason(0), WAIT_HALT);
+}
+
+TEST(chipScheduler, keyWaitSleepsUntilPressed){
+	// DT = 60; V0 = K; V1 = 1; loop
+	uint8_t rom[] = {0x60, 0x3C, 0xF0, 0x15, 0xF0, 0x0A, 0x61, 0x01, 0x70, 0x00, 0x12, 0x08};
+	Chip8Scheduler scheduler(10);
+	std::vector<Chip8> machines(100);
+	for (int i = 0; i < 100; ++i){
+		machines[i].load_rom(rom, sizeof(rom));
+		scheduler.add(&machines[i]);
+	}
+
+	EXPECT_EQ(scheduler.run_frame(), 100);
+	for (int f = 1; f < 30; ++f){
+		EXPECT_EQ(scheduler.run_frame(), 0);
+	}
+	EXPECT_EQ(scheduler.get_wait_reason(7), WAIT_KEY);
+
+	// Only the machine given the key runs, with its timer caught up
+	scheduler.set_key(7, 0x5, 1);
+	EXPECT_EQ(scheduler.run_frame(), 1);
+	EXPECT_EQ(machines[7].get_V(0), 0x5);
+	EXPECT_EQ(machines[7].get_V(1), 1);
+	EXPECT_EQ(machines[7].get_delay_timer(), 30);
+	EXPECT_EQ(machines[8].get_V(1), 0);
+	EXPECT_EQ(scheduler.get_wait_reason(7), WAIT_FRAME);
+	EXPECT_EQ(scheduler.run_frame(), 1);
+}
+
+}
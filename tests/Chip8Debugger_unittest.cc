@@ -0,0 +1,181 @@
+#include "../src/Chip8.h"
+#include "../src/Chip8Debugger.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+// V0 += 1; I = 0x300; store V0 at I; read it back into V0; loop
+uint8_t debugger_rom[] = {0x70, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0xF0, 0x65, 0x12, 0x00};
+
+void load_debugger_rom(Chip8 *c){
+	c->set_memory_block(0x200, debugger_rom, sizeof(debugger_rom));
+}
+
+TEST(chipDebugger, breakpointStopsAtPC){
+	Chip8 c;
+	load_debugger_rom(&c);
+	Chip8Debugger d(&c, 10);
+
+	d.add_breakpoint(0x206);
+	EXPECT_EQ(d.run(100), STOP_BREAKPOINT);
+	EXPECT_EQ(c.get_PC(), 0x206);
+	EXPECT_EQ(d.get_op_count(), 3u);
+
+	d.remove_breakpoint(0x206);
+	EXPECT_FALSE(d.is_armed());
+	EXPECT_EQ(d.run(100), STOP_NONE);
+}
+
+TEST(chipDebugger, watchpointsStopOnAccess){
+	Chip8 c;
+	load_debugger_rom(&c);
+	Chip8Debugger d(&c, 10);
+
+	d.add_watchpoint(0x300, WATCH_WRITE);
+	EXPECT_EQ(d.run(100), STOP_WATCH_WRITE);
+	EXPECT_EQ(d.get_stop_address(), 0x300);
+	EXPECT_EQ(c.get_at_memory_address(0x300), 1);
+
+	// Same page, different address: no stop
+	d.remove_watchpoint(0x300);
+	d.add_watchpoint(0x301, WATCH_READ | WATCH_WRITE);
+	EXPECT_EQ(d.run(20), STOP_NONE);
+
+	d.add_watchpoint(0x300, WATCH_READ);
+	EXPECT_EQ(d.run(100), STOP_WATCH_READ);
+	EXPECT_EQ(c.get_PC(), 0x208);
+}
+
+TEST(chipDebugger, registerConditions){
+	Chip8 c;
+	load_debugger_rom(&c);
+	Chip8Debugger d(&c, 10);
+
+	d.add_register_equals(0, 3);
+	EXPECT_EQ(d.run(100), STOP_REGISTER);
+	EXPECT_EQ(c.get_V(0), 3);
+
+	d.clear_register_conditions();
+	d.add_register_change(REGISTER_I);
+	EXPECT_EQ(d.run(100), STOP_NONE);
+}
+
+TEST(chipDebugger, stepBackRestoresEarlierState){
+	Chip8 c;
+	load_debugger_rom(&c);
+	Chip8Debugger d(&c, 4, 8);
+	c.set_delay_timer(50);
+
+	d.run(37);
+	Chip8 before = c;
+	d.step();
+	c.set_key(3, 1);
+	d.run(5);
+
+	for (int i = 0; i < 6; ++i){
+		EXPECT_TRUE(d.step_back());
+	}
+	EXPECT_EQ(d.get_op_count(), 37u);
+	EXPECT_EQ(c.get_PC(), before.get_PC());
+	EXPECT_EQ(c.get_V(0), before.get_V(0));
+	EXPECT_EQ(c.get_delay_timer(), before.get_delay_timer());
+	EXPECT_EQ(c.get_key(3), 0);
+	EXPECT_EQ(c.get_at_memory_address(0x300), before.get_at_memory_address(0x300));
+}
+
+TEST(chipDebugger, stepBackReplaysKeyInputs){
+	// loop { unless key 0 is down, V0 += 1; V1 += 1 }
+	uint8_t rom[] = {0xE1, 0x9E, 0x70, 0x01, 0x71, 0x01, 0x12, 0x00};
+	Chip8 c;
+	c.load_rom(rom, sizeof(rom));
+	Chip8 reference = c;
+
+	// One snapshot at op 0, so the key presses can only come from replay
+	Chip8Debugger d(&c, 4, 1000, 1);
+	d.run(10);
+	c.set_key(0, 1);
+	d.run(10);
+	c.set_key(0, 0);
+	d.run(10);
+
+	for (int i = 0; i < 5; ++i){
+		EXPECT_TRUE(d.step_back());
+	}
+	EXPECT_EQ(d.get_op_count(), 25u);
+
+	for (int i = 0; i < 25; ++i){
+		reference.set_key(0, i >= 10 && i < 20);
+		reference.execute_next_op();
+		if (i % 4 == 3){
+			reference.tick_timers();
+		}
+	}
+	EXPECT_EQ(c.get_state_hash(), reference.get_state_hash());
+	EXPECT_EQ(c.get_V(0), reference.get_V(0));
+	EXPECT_EQ(c.get_key(0), 0);
+
+	// Back before the press, the key reads as it did then
+	for (int i = 0; i < 10; ++i){
+		EXPECT_TRUE(d.step_back());
+	}
+	EXPECT_EQ(c.get_key(0), 1);
+}
+
+TEST(chipDebugger, copiesDoNotShareTheDebugger){
+	Chip8 c(MACHINE_XOCHIP);
+	load_debugger_rom(&c);
+	Chip8Debugger d(&c, 10);
+	d.add_watchpoint(0x300, WATCH_WRITE);
+
+	// A copy is detached and has its own memory
+	Chip8 copy = c;
+	EXPECT_EQ(copy.get_debugger(), (Chip8Debugger*) NULL);
+	for (int i = 0; i < 3; ++i){
+		copy.execute_next_op();
+	}
+	EXPECT_EQ(copy.get_at_memory_address(0x300), 1);
+	EXPECT_EQ(c.get_at_memory_address(0x300), 0);
+
+	// Assigning over the debugged machine keeps it attached
+	c = copy;
+	EXPECT_EQ(c.get_debugger(), &d);
+	EXPECT_EQ(d.run(100), STOP_WATCH_WRITE);
+}
+
+TEST(chipDebugger, unarmedRunKeepsRingOfSnapshots){
+	Chip8 c;
+	load_debugger_rom(&c);
+	Chip8 reference = c;
+	Chip8Debugger d(&c, 4, 8, 3);
+
+	// Snapshots at ops 80, 88 and 96 survive, so op 80 is as far back as we go
+	EXPECT_EQ(d.run(100), STOP_NONE);
+	for (int i = 0; i < 20; ++i){
+		EXPECT_TRUE(d.step_back());
+	}
+	EXPECT_FALSE(d.step_back());
+	EXPECT_EQ(d.get_op_count(), 80u);
+
+	for (int i = 0; i < 80; ++i){
+		reference.execute_next_op();
+		if (i % 4 == 3){
+			reference.tick_timers();
+		}
+	}
+	EXPECT_EQ(c.get_state_hash(), reference.get_state_hash());
+}
+
+TEST(chipDebugger, unarmedRunCountsOpsUpToHalt){
+	// V0 += 1 three times, then a NULL op partway into the second frame
+	uint8_t rom[] = {0x70, 0x01, 0x70, 0x01, 0x70, 0x01};
+	Chip8 c;
+	c.set_memory_block(0x200, rom, sizeof(rom));
+	Chip8Debugger d(&c, 2);
+
+	EXPECT_EQ(d.run(100), STOP_HALT);
+	EXPECT_EQ(d.get_op_count(), 3u);
+	EXPECT_EQ(c.get_V(0), 3);
+	EXPECT_EQ(c.get_executed_op_count(), 3u);
+}
+
+}
@@ -0,0 +1,94 @@
+#include "../src/Chip8Env.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+
+TEST(chipEnv, rejectsBadConfig){
+	Chip8EnvConfig config = {};
+	EXPECT_EQ(chip8_env_create(4, &config), (Chip8EnvBatch*)NULL);
+}
+
+TEST(chipEnv, rewardFromRamAddress){
+	// I = 0x300; loop { V0 += 1; store V0 at I }
+	uint8_t rom[] = {0xA3, 0x00, 0x70, 0x01, 0xF0, 0x55, 0x12, 0x02};
+	uint16_t reward_address = 0x300;
+
+	Chip8EnvConfig config = {};
+	config.rom = rom;
+	config.rom_length = sizeof(rom);
+	config.ops_per_frame = 3;
+	config.reward_addresses = &reward_address;
+	config.reward_address_count = 1;
+
+	Chip8EnvBatch *batch = chip8_env_create(2, &config);
+	ASSERT_NE(batch, (Chip8EnvBatch*)NULL);
+
+	int32_t actions[] = {CHIP8_ACTION_NONE, CHIP8_ACTION_NONE};
+	float rewards[2];
+	uint8_t dones[2];
+	chip8_env_step_batch(batch, actions, 4, NULL, rewards, dones);
+	EXPECT_EQ(rewards[0], 4.0f);
+	EXPECT_EQ(rewards[1], 4.0f);
+	EXPECT_EQ(dones[0], 0);
+
+	chip8_env_reset_one(batch, 1, NULL);
+	chip8_env_step_batch(batch, actions, 1, NULL, rewards, dones);
+	EXPECT_EQ(rewards[0], 1.0f);
+	EXPECT_EQ(rewards[1], 1.0f);
+
+	chip8_env_destroy(batch);
+}
+
+TEST(chipEnv, actionsAndObservations){
+	// Wait for key 0, then draw 0xF0 at (0, 0) and halt
+	uint8_t rom[] = {0xE0, 0x9E, 0x12, 0x00, 0xA2, 0x0A, 0xD0, 0x01, 0x00, 0x00, 0xF0};
+
+	Chip8EnvConfig config = {};
+	config.rom = rom;
+	config.rom_length = sizeof(rom);
+	config.obs_format = CHIP8_OBS_PACKED;
+
+	Chip8EnvBatch *batch = chip8_env_create(2, &config);
+	ASSERT_NE(batch, (Chip8EnvBatch*)NULL);
+	uint32_t obs_size = chip8_env_observation_size(batch);
+	EXPECT_EQ(obs_size, 256u);
+
+	std::vector<uint8_t> observations(2*obs_size, 0xAA);
+	chip8_env_reset(batch, observations.data());
+	EXPECT_EQ(observations[0], 0);
+
+	int32_t actions[] = {0, CHIP8_ACTION_NONE};
+	uint8_t dones[2];
+	chip8_env_step_batch(batch, actions, 1, observations.data(), NULL, dones);
+	EXPECT_EQ(dones[0], 1);
+	EXPECT_EQ(dones[1], 0);
+	EXPECT_EQ(observations[0], 0xF0);
+	EXPECT_EQ(observations[obs_size], 0);
+
+	chip8_env_destroy(batch);
+}
+
+TEST(chipEnv, stateHashesTrackDivergence){
+	uint8_t rom[] = {0xA3, 0x00, 0x70, 0x01, 0xF0, 0x55, 0x12, 0x02};
+	Chip8EnvConfig config = {};
+	config.rom = rom;
+	config.rom_length = sizeof(rom);
+	config.ops_per_frame = 3;
+
+	Chip8EnvBatch *batch = chip8_env_create(2, &config);
+	ASSERT_NE(batch, (Chip8EnvBatch*)NULL);
+
+	uint64_t hashes[2];
+	chip8_env_step_batch(batch, NULL, 2, NULL, NULL, NULL);
+	chip8_env_state_hashes(batch, hashes);
+	EXPECT_EQ(hashes[0], hashes[1]);
+
+	chip8_env_reset_one(batch, 1, NULL);
+	chip8_env_state_hashes(batch, hashes);
+	EXPECT_NE(hashes[0], hashes[1]);
+
+	chip8_env_destroy(batch);
+}
+
+}
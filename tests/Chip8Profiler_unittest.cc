@@ -0,0 +1,119 @@
+#include "../src/Chip8.h"
+#include "../src/Chip8Profiler.h"
+#include "gtest/gtest.h"
+#include <sstream>
+
+namespace {
+
+// main: loop { CALL 0x204 } ; 0x204: DRW V0, V0, 3; CALL 0x20A; RET ; 0x20A: RET
+uint8_t profiler_rom[] = {
+	0x22, 0x04,		// 0x200 CALL 0x204
+	0x12, 0x00,		// 0x202 JP 0x200
+	0xD0, 0x03,		// 0x204 DRW V0, V0, 3
+	0x22, 0x0A,		// 0x206 CALL 0x20A
+	0x00, 0xEE,		// 0x208 RET
+	0x00, 0xEE		// 0x20A RET
+};
+
+TEST(chipStack, callAndReturn){
+	Chip8 c;
+	c.set_memory_block(0x200, profiler_rom, sizeof(profiler_rom));
+
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x204);
+	EXPECT_EQ(c.get_SP(), 1);
+	c.execute_next_op();
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x20A);
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x208);
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x202);
+	EXPECT_EQ(c.get_SP(), 0);
+}
+
+TEST(chipProfiler, foldedStacksAndHits){
+	Chip8 c;
+	c.set_memory_block(0x200, profiler_rom, sizeof(profiler_rom));
+
+	Chip8Profiler p(&c);
+	for (int i = 0; i < 6*10; ++i){
+		p.execute_next_op();
+	}
+	EXPECT_EQ(p.get_hits(0x200), 10u);
+	EXPECT_EQ(p.get_hits(0x20A), 10u);
+
+	std::stringstream ops;
+	p.write_folded(ops, PROFILE_OPS);
+	EXPECT_EQ(ops.str(), "main 20\nmain;sub_204 30\nmain;sub_204;sub_20a 10\n");
+
+	std::stringstream pixels;
+	p.write_folded(pixels, PROFILE_PIXELS);
+	EXPECT_EQ(pixels.str(), "main;sub_204 240\n");
+
+	std::stringstream disassembly;
+	p.write_annotated_disassembly(disassembly);
+	EXPECT_NE(disassembly.str().find("sub_204:"), std::string::npos);
+	EXPECT_NE(disassembly.str().find("DRW V0, V0, 3"), std::string::npos);
+}
+
+TEST(chipProfiler, pixelsCountPlanesAndLargeSprites){
+	// Select both planes; DRW V0, V0, 0 (16x16); DRW V0, V0, 5; DRW on no planes
+	uint8_t rom[] = {0xF3, 0x01, 0xD0, 0x00, 0xD0, 0x05, 0xF0, 0x01, 0xD0, 0x05};
+	Chip8 xo(MACHINE_XOCHIP);
+	xo.load_rom(rom, sizeof(rom));
+
+	Chip8Profiler p(&xo);
+	for (int i = 0; i < 5; ++i){
+		p.execute_next_op();
+	}
+	std::stringstream pixels;
+	p.write_folded(pixels, PROFILE_PIXELS);
+	EXPECT_EQ(pixels.str(), "main 592\n");
+
+	// CHIP-8 has one plane, and its Dxy0 draws nothing
+	uint8_t chip8_rom[] = {0xD0, 0x00, 0xD0, 0x05};
+	Chip8 c;
+	c.load_rom(chip8_rom, sizeof(chip8_rom));
+
+	Chip8Profiler q(&c);
+	q.execute_next_op();
+	q.execute_next_op();
+	std::stringstream chip8_pixels;
+	q.write_folded(chip8_pixels, PROFILE_PIXELS);
+	EXPECT_EQ(chip8_pixels.str(), "main 40\n");
+}
+
+TEST(chipProfiler, callsPastDepthCapStayInDeepestPath){
+	// main: CALL 0x204 ; 0x204: V0 += 1; unless V0 == 70 CALL 0x204; RET
+	uint8_t rom[] = {0x22, 0x04, 0x12, 0x02, 0x70, 0x01, 0x30, 0x46, 0x22, 0x04, 0x00, 0xEE};
+	Chip8 c;
+	c.load_rom(rom, sizeof(rom));
+
+	// 70 nested calls of 3 ops, then 8 RETs; only 64 levels get nodes.
+	// The machine's stack wraps at 16, so stop before it runs dry.
+	Chip8Profiler p(&c);
+	for (int i = 0; i < 1 + 70*3 + 7; ++i){
+		p.execute_next_op();
+	}
+
+	std::stringstream ops;
+	p.write_folded(ops, PROFILE_OPS);
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(ops, line)){
+		lines.push_back(line);
+	}
+	ASSERT_EQ(lines.size(), 65u);
+	EXPECT_EQ(lines[0], "main 1");
+	for (size_t i = 1; i < 63; ++i){
+		EXPECT_EQ(lines[i].substr(lines[i].rfind(' ')), " 3");
+	}
+	// The first RET to pop a node returns here
+	EXPECT_EQ(lines[63].substr(lines[63].rfind(' ')), " 4");
+	// Levels 64-70's 21 ops, the 5 other RETs of overflowed calls, and
+	// the RET back to level 63
+	EXPECT_EQ(lines[64].substr(lines[64].rfind(' ')), " 27");
+}
+
+}
@@ -9,4 +9,268 @@ TEST(chipInit, initPC){
 	EXPECT_EQ(c.get_PC(), 0);
 }
 
-}
\ No newline at end of file
+TEST(chipInit, debugOff){
+	Chip8 c;
+	EXPECT_EQ(c.get_debug(), 0);
+}
+
+TEST(chipKeys, skipIfPressed){
+	Chip8 c;
+	uint8_t rom[] = {0xE0, 0x9E};	// SKP V0
+	c.set_memory_block(0x200, rom, 2);
+
+	c.set_key(0, 1);
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x204);
+
+	c.set_PC(0x200);
+	c.set_key(0, 0);
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x202);
+}
+
+TEST(chipKeys, waitForKeyPress){
+	Chip8 c;
+	uint8_t rom[] = {0xF3, 0x0A};	// LD V3, K
+	c.set_memory_block(0x200, rom, 2);
+
+	// Spins in place, and run_frame skips the spinning
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x200);
+	EXPECT_EQ(c.get_idle_loop_length(), 1);
+	EXPECT_EQ(c.run_frame(10), 1);
+	EXPECT_EQ(c.get_skipped_op_count(), 10u);
+
+	c.set_key(0xB, 1);
+	c.execute_next_op();
+	EXPECT_EQ(c.get_PC(), 0x202);
+	EXPECT_EQ(c.get_V(3), 0xB);
+}
+
+TEST(chipFrame, ticksTimersOncePerFrame){
+	Chip8 c;
+	uint8_t rom[] = {0x12, 0x00};	// JP 0x200
+	c.set_memory_block(0x200, rom, 2);
+	c.set_delay_timer(2);
+
+	EXPECT_EQ(c.run_frame(10), 1);
+	EXPECT_EQ(c.get_delay_timer(), 1);
+	EXPECT_EQ(c.run_frame(10), 1);
+	EXPECT_EQ(c.run_frame(10), 1);
+	EXPECT_EQ(c.get_delay_timer(), 0);
+}
+
+TEST(chipIdle, skipMatchesInterpretedDelayWait){
+	// DT = 10; wait until DT == 0; V2 = 5; halt
+	uint8_t rom[] = {0x60, 0x0A, 0xF0, 0x15, 0xF1, 0x07, 0x31, 0x00, 0x12, 0x04, 0x62, 0x05};
+	Chip8 fast, slow;
+	slow.set_idle_skip(false);
+	fast.set_memory_block(0x200, rom, sizeof(rom));
+	slow.set_memory_block(0x200, rom, sizeof(rom));
+
+	int fast_run = 1, slow_run = 1;
+	for (int frame = 0; frame < 20; ++frame){
+		fast_run = fast.run_frame(7);
+		slow_run = slow.run_frame(7);
+
+		ASSERT_EQ(fast_run, slow_run) << "frame " << frame;
+		ASSERT_EQ(fast.get_PC(), slow.get_PC()) << "frame " << frame;
+		ASSERT_EQ(fast.get_V(1), slow.get_V(1)) << "frame " << frame;
+		ASSERT_EQ(fast.get_V(2), slow.get_V(2)) << "frame " << frame;
+		ASSERT_EQ(fast.get_delay_timer(), slow.get_delay_timer()) << "frame " << frame;
+	}
+	EXPECT_EQ(fast_run, 0);
+	EXPECT_EQ(fast.get_V(2), 5);
+	EXPECT_GT(fast.get_skipped_op_count(), 0u);
+	EXPECT_EQ(slow.get_skipped_op_count(), 0u);
+	EXPECT_LT(fast.get_executed_op_count(), slow.get_executed_op_count());
+}
+
+TEST(chipIdle, keyWaitSkipsUntilPressed){
+	// Wait for key 0 to be pressed
+	uint8_t rom[] = {0xE0, 0x9E, 0x12, 0x00, 0x61, 0x01};
+	Chip8 c;
+	c.set_memory_block(0x200, rom, sizeof(rom));
+
+	c.run_frame(10);
+	EXPECT_EQ(c.get_PC(), 0x200);
+	EXPECT_EQ(c.get_skipped_op_count(), 10u);
+
+	c.set_key(0, 1);
+	c.run_frame(1);
+	EXPECT_EQ(c.get_PC(), 0x204);
+}
+
+TEST(chipDraw, xorAndCollision){
+	Chip8 c;
+	// I = 0x20A; DRW V0, V1, 1 twice at (62, 0); sprite 0xC3
+	uint8_t rom[] = {0xA2, 0x0A, 0x60, 0x3E, 0xD0, 0x11, 0xD0, 0x11, 0x00, 0x00, 0xC3};
+	c.set_memory_block(0x200, rom, sizeof(rom));
+
+	c.run_frame(3);
+	EXPECT_EQ(c.get_V(0xF), 0);
+	EXPECT_EQ(c.get_display_pixel(62, 0), 1);
+	EXPECT_EQ(c.get_display_pixel(63, 0), 1);
+	EXPECT_EQ(c.get_display_pixel(0, 0), 0);	// Clipped, not wrapped
+	EXPECT_EQ(c.get_display_row(0, 0)[0], 3u);
+
+	c.run_frame(1);
+	EXPECT_EQ(c.get_V(0xF), 1);
+	EXPECT_EQ(c.get_display_row(0, 0)[0], 0u);
+}
+
+TEST(chipDraw, spriteCacheMatchesUncached){
+	// loop { I = 0x300; draw, erase; V0 += 3; V2 += 1; store V0-V2 over
+	// the sprite; draw the changed sprite }
+	uint8_t rom[] = {
+		0xA3, 0x00, 0xD0, 0x15, 0xD0, 0x15, 0x70, 0x03,
+		0x72, 0x01, 0xF2, 0x55, 0xD0, 0x15, 0x12, 0x00
+	};
+	uint8_t sprite[] = {0xF0, 0x90, 0x90, 0x90, 0xF0};
+	Chip8 cached, uncached;
+	uncached.set_sprite_cache(false);
+	cached.load_rom(rom, sizeof(rom));
+	uncached.load_rom(rom, sizeof(rom));
+	cached.set_memory_block(0x300, sprite, sizeof(sprite));
+	uncached.set_memory_block(0x300, sprite, sizeof(sprite));
+
+	for (int f = 0; f < 200; ++f){
+		cached.run_frame(8);
+		uncached.run_frame(8);
+		ASSERT_EQ(cached.get_state_hash(), uncached.get_state_hash());
+		ASSERT_EQ(cached.get_V(15), uncached.get_V(15));
+	}
+	EXPECT_GT(cached.get_sprite_cache_hit_count(), 100u);
+	EXPECT_EQ(uncached.get_sprite_cache_hit_count(), 0u);
+}
+
+TEST(chipDraw, spriteCacheKeepsColumnsApart){
+	// I = 0x300; V0 = 0; loop { draw at (V0, 0); V0 += step }
+	uint8_t rom[] = {0xA3, 0x00, 0x60, 0x00, 0xD0, 0x18, 0x70, 0x08, 0x12, 0x04};
+	uint8_t steps[] = {8, 32};
+	for (uint8_t step : steps){
+		rom[7] = step;
+		Chip8 c;
+		c.load_rom(rom, sizeof(rom));
+
+		// Only the first draw at each column misses
+		int columns = 64 / step;
+		for (int i = 0; i < 2 + 3 * 2 * columns; ++i){
+			c.execute_next_op();
+		}
+		EXPECT_EQ(c.get_sprite_cache_hit_count(), (uint64_t) columns);
+	}
+}
+
+TEST(chipXO, longLoadAndRegisterRanges){
+	Chip8 c(MACHINE_XOCHIP);
+	EXPECT_EQ(c.get_memory_size(), 0x10000u);
+
+	uint8_t rom[] = {
+		0x61, 0x11, 0x62, 0x22, 0x63, 0x33,	// V1..V3 = 11, 22, 33
+		0xF0, 0x00, 0xE0, 0x00,				// I = 0xE000
+		0x51, 0x32,							// SAVE V1 - V3
+		0x53, 0x13,							// LOAD V3 - V1 (reversed)
+		0x30, 0x00,							// SE V0, 0 skips the whole F000 nnnn
+		0xF0, 0x00, 0x12, 0x34,
+		0x64, 0x44							// V4 = 44
+	};
+	c.load_rom(rom, sizeof(rom));
+	for (int i = 0; i < 9; ++i){
+		c.execute_next_op();
+	}
+
+	EXPECT_EQ(c.get_at_memory_address(0xE000), 0x11);
+	EXPECT_EQ(c.get_at_memory_address(0xE002), 0x33);
+	EXPECT_EQ(c.get_V(1), 0x33);
+	EXPECT_EQ(c.get_V(3), 0x11);
+	EXPECT_EQ(c.get_I(), 0xE000);
+	EXPECT_EQ(c.get_V(4), 0x44);
+}
+
+TEST(chipXO, planesHiresAndScrolling){
+	Chip8 c(MACHINE_XOCHIP);
+
+	uint8_t rom[] = {
+		0x00, 0xFF,				// HIGH
+		0xF3, 0x01,				// PLANE 3
+		0xA3, 0x00,				// I = 0x300
+		0x60, 0x7C,				// V0 = 124
+		0xD1, 0x11,				// DRW V1, V1, 1 at (0, 0) on both planes
+		0xD0, 0x11,				// DRW V0, V1, 1 at (124, 0), wraps
+		0xF1, 0x01,				// PLANE 1
+		0x00, 0xC2,				// SCD 2
+		0x00, 0xFB				// SCR
+	};
+	uint8_t sprites[] = {0xF0, 0x0F};
+	c.load_rom(rom, sizeof(rom));
+	c.set_memory_block(0x300, sprites, sizeof(sprites));
+
+	for (int i = 0; i < 6; ++i){
+		c.execute_next_op();
+	}
+	EXPECT_TRUE(c.get_hires());
+	EXPECT_EQ(c.get_display_width(), 128);
+	// Plane 0 gets F0 and plane 1 gets 0F from each draw. The second
+	// draw's plane 1 pixels wrap round to x = 0.
+	EXPECT_EQ(c.get_display_pixel(0, 0), 3);
+	EXPECT_EQ(c.get_display_pixel(4, 0), 2);
+	EXPECT_EQ(c.get_display_pixel(124, 0), 1);
+	EXPECT_EQ(c.get_display_row(1, 0)[0], 0xFF00000000000000ull);
+	EXPECT_EQ(c.get_display_row(1, 0)[1], 0u);
+
+	// Scrolls only move plane 0
+	c.execute_next_op();
+	c.execute_next_op();
+	c.execute_next_op();
+	EXPECT_EQ(c.get_display_pixel(0, 0), 2);
+	EXPECT_EQ(c.get_display_pixel(0, 2), 0);
+	EXPECT_EQ(c.get_display_pixel(4, 2), 1);
+	EXPECT_EQ(c.get_display_pixel(124, 2), 0);
+}
+
+TEST(chipHash, incrementalMatchesRecompute){
+	// I = 0x300; loop { V0 += 1; store V0 at I; draw at (V0, V1) }
+	uint8_t rom[] = {0xA3, 0x00, 0x70, 0x01, 0xF0, 0x55, 0xD0, 0x11, 0x12, 0x02};
+	Chip8 c;
+	EXPECT_EQ(c.get_state_hash(), c.compute_state_hash());
+	c.load_rom(rom, sizeof(rom));
+
+	for (int f = 0; f < 50; ++f){
+		c.run_frame(8);
+		ASSERT_EQ(c.get_state_hash(), c.compute_state_hash());
+	}
+	EXPECT_NE(c.get_display_hash(), 0u);
+
+	// Clearing everything brings the hashes back to zero
+	c.fill_display(0);
+	EXPECT_EQ(c.get_display_hash(), 0u);
+	c.reset();
+	EXPECT_EQ(c.get_memory_hash(), 0u);
+}
+
+TEST(chipHash, findsFirstDivergentFrame){
+	uint8_t rom[] = {0xA3, 0x00, 0x70, 0x01, 0xF0, 0x55, 0xD0, 0x11, 0x12, 0x02};
+	Chip8 a, b;
+	a.load_rom(rom, sizeof(rom));
+	b.load_rom(rom, sizeof(rom));
+
+	int diverged = -1;
+	for (int f = 0; f < 40 && diverged < 0; ++f){
+		if (f == 17){
+			b.set_memory_address(0x400, 1);
+		}
+		a.run_frame(8);
+		b.run_frame(8);
+		if (a.get_state_hash() != b.get_state_hash()){
+			diverged = f;
+		}
+	}
+	EXPECT_EQ(diverged, 17);
+
+	// Undoing the write makes the states, and so the hashes, equal again
+	b.set_memory_address(0x400, 0);
+	EXPECT_EQ(a.get_state_hash(), b.get_state_hash());
+}
+
+}
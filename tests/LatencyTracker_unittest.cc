@@ -0,0 +1,69 @@
+#include "../src/Chip8.h"
+#include "../src/LatencyTracker.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(latencyTracker, followsKeyPressToPresent){
+	// I = 0x208; V0 = K; draw at (V0, V1); JP self; sprite FF
+	uint8_t rom[] = {0xA2, 0x08, 0xF0, 0x0A, 0xD0, 0x11, 0x12, 0x06, 0xFF};
+	Chip8 c;
+	c.load_rom(rom, sizeof(rom));
+
+	LatencyTracker latency(1.0 / 60);
+	latency.frame_started(&c, 0.000);
+	c.run_frame(10);
+	latency.frame_emulated(&c, 0.000);
+	latency.frame_presented(0.016);
+	// The wait is fast-forwarded, so the keypad hasn't been read yet
+	EXPECT_EQ(c.get_key_read_count(), 0u);
+	EXPECT_EQ(c.get_display_change_count(), 0u);
+
+	latency.key_received(0.020);
+	c.set_key(0x3, 1);
+	latency.key_applied(&c, 0.021);
+	// Two ops run: the read ends halfway through the burst, the draw at its end
+	latency.frame_started(&c, 0.021);
+	c.run_frame(10);
+	latency.frame_emulated(&c, 0.023);
+	EXPECT_EQ(c.get_display_change_count(), 1u);
+	EXPECT_EQ(latency.get_sample_count(), 0u);
+
+	latency.frame_presented(0.030);
+	ASSERT_EQ(latency.get_sample_count(), 1u);
+	EXPECT_NEAR(latency.get_percentile(SPAN_APPLY, 50), 0.001, 0.0001);
+	EXPECT_NEAR(latency.get_percentile(SPAN_OBSERVE, 50), 0.001, 0.0001);
+	EXPECT_NEAR(latency.get_percentile(SPAN_DRAW, 50), 0.001, 0.0001);
+	EXPECT_NEAR(latency.get_percentile(SPAN_PRESENT, 99), 0.007, 0.0001);
+	EXPECT_NEAR(latency.get_max(SPAN_TOTAL), 0.010, 0.0001);
+
+	// A press the guest never reacts to is dropped by the next one
+	latency.key_received(0.040);
+	latency.key_received(0.050);
+	EXPECT_EQ(latency.get_abandoned_count(), 1u);
+
+	// 50ms between presents misses vsync
+	latency.frame_presented(0.080);
+	EXPECT_EQ(latency.get_missed_frame_count(), 1u);
+	EXPECT_EQ(latency.get_frame_count(), 3u);
+}
+
+TEST(latencyTracker, probeCountsOpsRunOneByOne){
+	// V2 = 1; V0 = K; draw at (V0, V1); JP self; sprite FF
+	uint8_t rom[] = {0x62, 0x01, 0xA2, 0x0A, 0xF0, 0x0A, 0xD0, 0x11, 0x12, 0x08, 0xFF};
+	Chip8 c;
+	c.load_rom(rom, sizeof(rom));
+	c.execute_next_op();
+	c.execute_next_op();
+	EXPECT_EQ(c.get_executed_op_count(), 2u);
+
+	c.arm_latency_probe();
+	c.set_key(0x3, 1);
+	c.execute_next_op();
+	c.execute_next_op();
+	EXPECT_EQ(c.get_probe_key_read_op(), 2u);
+	EXPECT_EQ(c.get_probe_display_change_op(), 3u);
+	EXPECT_EQ(c.get_display_change_count(), 1u);
+}
+
+}
@@ -0,0 +1,62 @@
+#include "../src/Chip8.h"
+#include "../src/RomLoader.h"
+#include "gtest/gtest.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string write_temp_rom(const std::string &name, const std::vector<uint8_t> &data){
+	std::string path = testing::TempDir() + name;
+	std::ofstream os(path, std::ofstream::binary);
+	os.write((const char*)data.data(), data.size());
+	return path;
+}
+
+TEST(romLoader, prefetchesValidRomsInOrder){
+	std::string first = write_temp_rom("loader_first.ch8", std::vector<uint8_t>(4, 0x11));
+	std::string empty = write_temp_rom("loader_empty.ch8", std::vector<uint8_t>());
+	std::string large = write_temp_rom("loader_large.ch8", std::vector<uint8_t>(4096, 0x22));
+	std::string second = write_temp_rom("loader_second.ch8", std::vector<uint8_t>(6, 0x33));
+
+	RomLoader loader(1);
+	loader.enqueue(first);
+	loader.enqueue(empty);
+	loader.enqueue(large);
+	loader.enqueue(testing::TempDir() + "loader_missing.ch8");
+	loader.enqueue(second);
+
+	Rom rom;
+	ASSERT_TRUE(loader.wait_next(rom));
+	EXPECT_EQ(rom.path, first);
+	EXPECT_EQ(rom.data.size(), 4u);
+
+	ASSERT_TRUE(loader.wait_next(rom));
+	EXPECT_EQ(rom.path, second);
+	EXPECT_EQ(rom.data[0], 0x33);
+
+	EXPECT_FALSE(loader.wait_next(rom));
+	EXPECT_FALSE(loader.take_next(rom));
+	EXPECT_EQ(loader.take_errors().size(), 3u);
+}
+
+TEST(romLoader, loadRomKeepsInterpreterArea){
+	Chip8 c;
+	c.set_memory_address(0x010, 0xF0);
+	uint8_t first[] = {0x60, 0x05, 0x12, 0x02};
+	uint8_t second[] = {0x61, 0x07};
+
+	c.load_rom(first, sizeof(first));
+	c.run_frame(4);
+	EXPECT_EQ(c.get_V(0), 5);
+
+	EXPECT_EQ(c.load_rom(second, sizeof(second)), 1);
+	EXPECT_EQ(c.get_PC(), 0x200);
+	EXPECT_EQ(c.get_V(0), 0);
+	EXPECT_EQ(c.get_at_memory_address(0x202), 0);
+	EXPECT_EQ(c.get_at_memory_address(0x010), 0xF0);
+	EXPECT_EQ(c.get_debug(), 0);
+}
+
+}
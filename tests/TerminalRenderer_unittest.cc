@@ -0,0 +1,63 @@
+#include "../src/Chip8.h"
+#include "../src/TerminalRenderer.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace {
+
+TEST(terminalRenderer, sendsOnlyChangedCells){
+	Chip8 c;
+	TerminalRenderer renderer(TERMINAL_HALF_BLOCK, 0);
+	std::string out;
+
+	ASSERT_TRUE(renderer.render(&c, 0, out));
+	EXPECT_EQ(renderer.get_columns(), 64);
+	EXPECT_EQ(renderer.get_rows(), 16);
+	EXPECT_EQ(out.substr(0, 8), "\x1b[0m\x1b[2J");
+
+	// Nothing changed, nothing sent
+	out.clear();
+	EXPECT_FALSE(renderer.render(&c, 1, out));
+	EXPECT_TRUE(out.empty());
+
+	// Pixel (10, 5) is the lower half of cell (10, 2). The background is
+	// already the default from the first frame.
+	c.set_display_pixel(5*64 + 10, 1);
+	ASSERT_TRUE(renderer.render(&c, 2, out));
+	EXPECT_EQ(out, "\x1b[3;11H\x1b[37m\xe2\x96\x84");
+
+	// The cursor is already in place for the next cell, and a two cell
+	// gap is cheaper to rewrite than to move over
+	out.clear();
+	c.set_display_pixel(5*64 + 11, 1);
+	c.set_display_pixel(4*64 + 14, 1);
+	ASSERT_TRUE(renderer.render(&c, 3, out));
+	EXPECT_EQ(out, "\xe2\x96\x84  \xe2\x96\x80");
+}
+
+TEST(terminalRenderer, brailleAndRateLimits){
+	Chip8 c;
+	TerminalRenderer renderer(TERMINAL_BRAILLE, 10, 1000);
+	std::string out;
+
+	ASSERT_TRUE(renderer.render(&c, 0, out));
+	EXPECT_EQ(renderer.get_columns(), 32);
+	EXPECT_EQ(renderer.get_rows(), 8);
+
+	// Too soon after the last frame
+	c.set_display_pixel(0, 1);
+	out.clear();
+	EXPECT_FALSE(renderer.render(&c, 0.05, out));
+	EXPECT_EQ(renderer.get_frames_dropped(), 1u);
+
+	// The first frame overdrew the byte budget, so we wait for it to refill
+	EXPECT_FALSE(renderer.render(&c, 0.15, out));
+	EXPECT_EQ(renderer.get_frames_dropped(), 2u);
+
+	// Pixels (0, 0) and (1, 3) are dots 1 and 8 of the first cell
+	c.set_display_pixel(3*64 + 1, 1);
+	ASSERT_TRUE(renderer.render(&c, 1.5, out));
+	EXPECT_EQ(out, "\x1b[1;1H\x1b[37m\xe2\xa2\x81");
+}
+
+}
@@ -0,0 +1,49 @@
+#include "../src/Chip8.h"
+#include "../src/TileAtlas.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+namespace {
+
+TEST(tileAtlas, layoutAndDirtyTracking){
+	TileAtlas atlas(256, 64, 32);
+	EXPECT_EQ(atlas.get_columns(), 12);
+	EXPECT_EQ(atlas.get_rows(), 22);
+	EXPECT_EQ(atlas.get_tile_x(13), 64);
+	EXPECT_EQ(atlas.get_tile_y(13), 32);
+
+	Chip8 c;
+	std::vector<uint32_t> pixels(64*32);
+	EXPECT_TRUE(atlas.is_dirty(0, &c));
+	atlas.write_tile(0, &c, pixels.data(), 64*4);
+	EXPECT_FALSE(atlas.is_dirty(0, &c));
+	EXPECT_TRUE(atlas.is_dirty(1, &c));
+
+	c.set_display_pixel(3*64 + 5, 1);
+	EXPECT_TRUE(atlas.is_dirty(0, &c));
+	atlas.write_tile(0, &c, pixels.data(), 64*4);
+	EXPECT_FALSE(atlas.is_dirty(0, &c));
+	EXPECT_EQ(pixels[3*64 + 5], 0xFF00FF00u);
+	EXPECT_EQ(pixels[3*64 + 6], 0xFF000000u);
+
+	// Back to a blank display, which the tile showed before
+	c.set_display_pixel(3*64 + 5, 0);
+	EXPECT_TRUE(atlas.is_dirty(0, &c));
+}
+
+TEST(tileAtlas, loresScalesIntoXOTile){
+	TileAtlas atlas(4, 128, 64);
+	Chip8 c(MACHINE_XOCHIP);
+	c.set_display_pixel(1*64 + 2, 3);
+
+	// Tiles are written through a pitch wider than the tile
+	int pitch = 256*4;
+	std::vector<uint32_t> pixels(256*64);
+	atlas.write_tile(0, &c, pixels.data(), pitch);
+	EXPECT_EQ(pixels[2*256 + 4], 0xFFFFFFFFu);
+	EXPECT_EQ(pixels[3*256 + 5], 0xFFFFFFFFu);
+	EXPECT_EQ(pixels[3*256 + 6], 0xFF000000u);
+	EXPECT_EQ(pixels[2*256 + 128], 0u);
+}
+
+}
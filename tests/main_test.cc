@@ -1,4 +1,12 @@
 #include "Chip8_unittest.cc"
+#include "Chip8Env_unittest.cc"
+#include "Chip8Coroutine_unittest.cc"
+#include "Chip8Debugger_unittest.cc"
+#include "Chip8Profiler_unittest.cc"
+#include "LatencyTracker_unittest.cc"
+#include "RomLoader_unittest.cc"
+#include "TerminalRenderer_unittest.cc"
+#include "TileAtlas_unittest.cc"
 #include "gtest/gtest.h"
 
 int main(int argc, char *argv[]){